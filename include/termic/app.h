@@ -6,11 +6,13 @@
 #include "size.h"
 #include "input.h"
 #include "screen.h"
+#include "pacing.h"
 
 #include <signals.hpp>
 
 #include <chrono>
 #include <functional>
+#include <atomic>
 using namespace std::literals;
 
 namespace termic
@@ -76,12 +78,25 @@ struct App
 	void trigger_render();
 	void quit();
 
+	// limit how often the screen is updated; everything drawn within a frame's interval
+	//   is then written as one update (0 = update after every input/event, the default)
+	void set_max_fps(std::size_t fps);
+	// limit how long a single screen update may take (0 = no limit, the default);
+	//   an unfinished update continues in the next loop iteration, after handling pending input
+	void set_update_budget(std::chrono::microseconds budget);
+	// while the terminal is resized repeatedly (e.g. dragging a window edge), wait until its size has been
+	//   stable for 'settle' before resizing the screen (0 = immediately, the default). with an 'intermediate'
+	//   interval, the screen is also resized meanwhile, at most that often (see event::Resize::intermediate)
+	void set_resize_debounce(std::chrono::milliseconds settle, std::chrono::milliseconds intermediate=0ms);
+
 	Screen &screen() { return _screen; }
 
 
 private:
 	void shutdown(int rc=0);
 	bool dispatch_event(const event::Event &e);
+	void update_screen();
+	void resize_screen(bool intermediate);
 
 
 private:
@@ -90,9 +105,16 @@ private:
 
 	bool _emit_resize_event { false };
 
+	std::atomic<std::size_t> _resize_signals { 0 };  // SIGWINCH received (not yet seen by the loop)
+	ResizeDebouncer _resize;
+
 	bool _initialized { false };
 
 	bool _should_quit { false };
+
+	FramePacer _pacer;
+	std::chrono::microseconds _update_budget { 0 };
+	bool _update_continues { false };
 };
 
 } // NS: termic
@@ -8,7 +8,7 @@
 namespace termic
 {
 
-struct Screen;
+struct RegionI;
 
 namespace color
 {
@@ -18,7 +18,7 @@ struct UV;
 
 struct Canvas
 {
-	inline Canvas(Screen &scr) : _screen(scr) {};
+	inline Canvas(RegionI &region) : _region(region) {};
 
 	void clear();
 	Size size() const;
@@ -36,7 +36,7 @@ struct Canvas
 	void fade(Rectangle rect, Color fg, Color bg, float blend=0.5f);
 
 private:
-	Screen &_screen;
+	RegionI &_region;
 };
 
 } // NS: termic
@@ -153,6 +153,8 @@ struct Resize
 		std::size_t y { 0 };  // only applicable for sub-surfaces
 		Size size { 0, 0 };
 	} old {};
+
+	bool intermediate { false };  // more resizes are expected (e.g. a window edge is dragged); draw cheaply
 };
 struct Focus
 {
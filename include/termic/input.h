@@ -29,7 +29,12 @@ struct Input
 
 	void set_double_click_duration(milliseconds duration);
 
-	std::vector<event::Event> read();
+	// wait for input (or a timer, signal, etc), but at most 'timeout' (if specified)
+	std::vector<event::Event> read(std::optional<microseconds> timeout={});
+	// also stop waiting when the output is ready for more (see Screen::output_poll()); a negative fd: don't
+	void watch_output(::pollfd output);
+	// parse 'chars' before what's read next, e.g. input that arrived while something else was reading (see term::init())
+	void unread(std::string_view chars);
 
 	static constexpr std::size_t max_timers { 16 };
 	static constexpr milliseconds min_timer_duration { 10ms };
@@ -51,8 +56,10 @@ private:
 		SignalReceived,
 		RenderTriggered,
 		TimerTriggered,
+		OutputReady,
+		TimedOut,
 	};
-	WaitResult wait();
+	WaitResult wait(std::optional<microseconds> timeout);
 	bool setup_keys();
 	std::variant<event::Event, int> parse_mouse(std::string_view in, std::size_t &eaten);
 	void _cancel_timer(std::uint64_t id);
@@ -60,6 +67,7 @@ private:
 
 private:
 	std::istream &_in;
+	std::string _unread;  // parsed before what's read from the stream
 
 	struct KeySequence
 	{
@@ -74,6 +82,7 @@ private:
 	// Timer id -> event fd
 	std::unordered_map<std::uint64_t, int> _timer_id_fd;
 	int _render_trigger_fd { 0 };
+	::pollfd _output_poll { .fd = -1, .events = 0, .revents = 0 };
 	// event fd -> TimerInfo
 	struct TimerInfo
 	{
@@ -87,7 +96,8 @@ private:
 
 	static constexpr auto input_fd_idx { 0u };
 	static constexpr auto trigger_fd_idx { input_fd_idx + 1 };
-	static constexpr auto first_timer_fd_idx { trigger_fd_idx + 1 };
+	static constexpr auto output_fd_idx { trigger_fd_idx + 1 };
+	static constexpr auto first_timer_fd_idx { output_fd_idx + 1 };
 	::pollfd _pollfds[first_timer_fd_idx + max_timers];
 };
 
@@ -17,6 +17,7 @@ namespace color
 
 constexpr static Color Default   = 0x01000000;
 constexpr static Color NoChange  = 0x02000000;
+constexpr static Color Transparent = 0x03000000;  // background of layers; shows what's below
 constexpr static Color Black     = 0x000000;
 constexpr static Color Red       = 0xff0000;
 constexpr static Color Green     = 0x00ff00;
@@ -66,7 +67,7 @@ Color lerp(Color a, Color b, float blend);
 
 inline std::string escify(Color c)
 {
-	if(c == color::Default)
+	if(c == color::Default or c == color::Transparent)
 		return "9";
 
 	// TODO: generate 256 or "classic" colors if 24-bit isn't supported
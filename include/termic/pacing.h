@@ -0,0 +1,68 @@
+#pragma once
+
+#include <chrono>
+#include <optional>
+#include <cstddef>
+
+namespace termic
+{
+
+using namespace std::literals;
+
+// when the app's loop updates the screen: at most once per frame interval, so everything drawn
+//   within an interval is written as one update (see App::set_max_fps())
+struct FramePacer
+{
+	using Clock = std::chrono::steady_clock;
+
+	std::chrono::microseconds interval { 0 };  // 0 = no limit
+
+	// whether an update is due at 'now'; otherwise it's postponed. a continued update (the budget ran out) always is
+	bool due(Clock::time_point now, bool continues=false) const;
+	// an update (not a continued one) started at 'now'
+	inline void updated(Clock::time_point now) { _last_frame = now; }
+	// how long to wait (for input) at most, while an update is pending
+	std::chrono::microseconds wait(Clock::time_point now) const;
+
+	// also when it's due already, e.g. to retry an update that was dropped (the terminal was congested)
+	static constexpr std::chrono::microseconds min_wait { 2ms };
+
+private:
+	Clock::time_point _last_frame;
+};
+
+// when the app resizes the screen, after the terminal was resized (see App::set_resize_debounce())
+struct ResizeDebouncer
+{
+	using Clock = std::chrono::steady_clock;
+
+	std::chrono::milliseconds settle { 0 };        // 0 = resize immediately
+	std::chrono::milliseconds intermediate { 0 };  // 0 = only once it settled
+
+	enum Due
+	{
+		NotDue,
+		Intermediate,
+		Final,
+	};
+
+	// the terminal was resized 'signals' times (SIGWINCH) since the previous call, i.e. a burst continues
+	void signalled(std::size_t signals, Clock::time_point now);
+	// whether the screen should be resized at 'now'
+	Due due(Clock::time_point now) const;
+	// the screen was resized at 'now'; returns whether it should also be repainted
+	bool resized(Clock::time_point now, bool intermediate);
+	// how long to wait (for input) at most, until a resize is due; none, if there's nothing to resize
+	std::optional<std::chrono::microseconds> wait(Clock::time_point now) const;
+
+	// terminal resizes not applied to the screen yet (meanwhile, it shouldn't be updated)
+	inline std::size_t burst() const { return _burst; }
+
+private:
+	std::size_t _burst { 0 };
+	bool _pending { false };  // a (final) resize is due eventually
+	Clock::time_point _last_signal;
+	Clock::time_point _last_resize;
+};
+
+} // NS: termic
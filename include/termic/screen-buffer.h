@@ -2,6 +2,8 @@
 
 #include <vector>
 #include <memory>
+#include <algorithm>
+#include <cstdint>
 
 #include "cell.h"
 #include "size.h"
@@ -21,21 +23,98 @@ struct ScreenBuffer
 
 	inline Cell &cell(Pos pos)
 	{
+		// the caller might modify the cell
+		mark_dirty(pos.y, pos.x, pos.x);
+		materialize(pos.y);
+		_stale_hashes[pos.y] = true;
 		return _buffer[pos.y*_width + pos.x];
 	}
 	inline const Cell &cell(Pos pos) const
 	{
+		materialize(pos.y);
 		return _buffer[pos.y*_width + pos.x];
 	}
 	void set_cell(Pos pos, std::string_view ch, std::size_t width, Look lk=look::Default);
 
+	ScreenBuffer() = default;
+	ScreenBuffer(ScreenBuffer &&) = default;
+	ScreenBuffer &operator = (ScreenBuffer &&) = default;  // unlike a copy, includes the dirty state
 	ScreenBuffer &operator = (const ScreenBuffer &that);
 
+	// columns (inclusive) of a row that were written since the row was last cleaned
+	struct Span
+	{
+		std::size_t first;
+		std::size_t last;
+
+		inline bool empty() const { return first > last; }
+	};
+	inline bool is_dirty(std::size_t y) const { return not _dirty_rows[y].empty(); }
+	inline Span dirty_span(std::size_t y) const { return _dirty_rows[y]; }
+	inline void mark_dirty(std::size_t y, std::size_t first, std::size_t last)
+	{
+		auto &span = _dirty_rows[y];
+		span.first = std::min(span.first, first);
+		span.last = std::max(span.last, last);
+	}
+	void mark_dirty();
+	inline void clear_dirty(std::size_t y) { _dirty_rows[y] = clean_span; }
+	inline void clear_dirty() { std::fill(_dirty_rows.begin(), _dirty_rows.end(), clean_span); }
+
+	// move the rows within [top, bottom] 'lines' rows up (negative: down), like a terminal scroll region
+	//   the rows scrolled in are blank
+	void scroll(std::size_t top, std::size_t bottom, int lines);
+
+	// move the cells of a row, from column 'x' to the right edge, 'cells' columns right (negative: left),
+	//   like a terminal's insert/delete character; the cells shifted in are blank
+	void shift_cells(std::size_t y, std::size_t x, int cells);
+
+	// copy a span of a row from 'src' (of the same size)
+	//   NOTE: the rest of the row must already be identical; the row adopts the hash of 'src'
+	void copy_span(const ScreenBuffer &src, std::size_t y, Span span);
+
+	// copy a rectangle of 'src' to 'pos', clipped to both buffers (a row at a time)
+	void blit(const ScreenBuffer &src, Rectangle src_rect, Pos pos);
+
+	// hash of a row's content; rows with equal content have equal hashes
+	inline std::uint64_t row_hash(std::size_t y) const
+	{
+		if(_stale_hashes[y])
+			rehash(y);
+		return _row_hashes[y];
+	}
+
 	// if true, set_size() attempts to preserve existing content
 	bool preserve_content { false };
 
 private:
-	std::vector<Cell> _buffer;
+	void rehash(std::size_t y) const;
+
+	// a row not written since a (full) clear is still in an earlier epoch; it's actually cleared when first accessed
+	inline void materialize(std::size_t y) const
+	{
+		if(_row_epochs[y] != _epoch)
+			clear_row(y);
+	}
+	void clear_row(std::size_t y) const;
+
+private:
+	static constexpr Span clean_span { static_cast<std::size_t>(-1), 0 };
+
+	mutable std::vector<Cell> _buffer;  // (rows are lazily cleared, see materialize())
+	std::vector<Span> _dirty_rows;
+
+	// clear() only starts a new epoch, i.e. it's O(rows) rather than O(cells)
+	std::uint64_t _epoch { 0 };
+	mutable std::vector<std::uint64_t> _row_epochs;
+	Cell _cleared;                       // what all cells of a row from an earlier epoch looks like
+	std::uint64_t _cleared_hash { 0 };   // and its row hash
+
+	// row hashes are updated incrementally by set_cell() and clear(),
+	//   other modifications (e.g. via cell()) makes it stale, i.e. re-calculated when asked for
+	//   (not a vector<bool>, so different rows can be modified concurrently)
+	mutable std::vector<std::uint64_t> _row_hashes;
+	mutable std::vector<std::uint8_t> _stale_hashes;
 
 	std::size_t _width { 0 };
 	std::size_t _height { 0 };
@@ -1,10 +1,18 @@
 #pragma once
 
 #include <cstdint>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <mutex>
+#include <atomic>
+
+#include <poll.h>
 
 #include "cell.h"
 #include "screen-buffer.h"
 #include "size.h"
+#include "terminal.h"
 
 namespace termic
 {
@@ -16,101 +24,329 @@ enum Alignment
 	Right
 };
 
-//struct RegionI
-//{
-//  virtual Rectangle rect() const = 0;
-//	virtual inline void clear() = 0;
-//	virtual void clear(Color bg, Color fg=color::NoChange) = 0;
-//	virtual void clear(const Rectangle &rect, Color bg, Color fg=color::NoChange) = 0;
-
-//	virtual void go_to(Pos pos) = 0;
-//	virtual std::size_t print(std::string_view s, Color fg=color::Default, Color bg=color::NoChange, Style style=style::Default) = 0;
-//	virtual std::size_t print(Alignment align, Pos anchor_pos, std::string_view s, Color fg=color::Default, Color bg=color::NoChange, Style style=style::Default) = 0;
-//	virtual std::size_t print(Pos pos, std::string_view s, Color fg=color::Default, Color bg=color::NoChange, Style style=style::Default) = 0;
-//};
-
-//struct Region;
+struct Region;
+struct Surface;
+struct UringWriter;
 
-struct Screen //: public RegionI
+// something to draw on; the whole screen or a part of it (see Region)
+//   all positions are relative to its top left corner
+struct RegionI
 {
-	Screen(int fd);
+	virtual ~RegionI() = default;
 
-//	Region region(Rectangle rect) const; // TODO: what about resizing? need to be able to define position/size as fixed or percentage of parent
-	void invalidate();
+	virtual Size size() const = 0;
+	inline Rectangle rect() const { return { { 0, 0 }, size() }; }
 
-	inline void clear()  { clear(color::Default, color::Default); }
-	void clear(Color bg, Color fg=color::NoChange);
-	void clear(const Rectangle &rect, Color bg, Color fg=color::NoChange);
+	inline void invalidate() { invalidate(rect()); }
+	virtual void invalidate(Rectangle rect) = 0;
 
-	void go_to(Pos pos);
+	inline void clear() { clear(color::Default, color::Default); }
+	virtual void clear(Color bg, Color fg=color::NoChange) = 0;
+	virtual void clear(const Rectangle &rect, Color bg, Color fg=color::NoChange) = 0;
+
+	virtual void go_to(Pos pos) = 0;
+	virtual Pos cursor() const = 0;
 	inline std::size_t print(std::string_view s, Look lk=look::Default)
 	{
-		return print(_client_cursor, s, lk);
+		return print(cursor(), s, lk);
 	}
 	std::size_t print(Alignment align, Pos anchor_pos, std::string_view s, Look lk=look::Default);
-	std::size_t print(Pos pos, std::string_view s, Look lk=look::Default);
+	virtual std::size_t print(Pos pos, std::string_view s, Look lk=look::Default) = 0;
 	std::size_t print(Pos pos, std::size_t wrap_width, std::string_view s, Look lk=look::Default);
 
-	void update();
+	std::size_t measure(std::string_view s) const;
+
+	// copy (a part of) an offscreen surface, clipped to this
+	void blit(const Surface &src, Pos pos);
+	virtual void blit(const Surface &src, Rectangle src_rect, Pos pos) = 0;
+
+protected:
+	friend struct Canvas;  // direct access to the cells
+	virtual Cell &cell(Pos pos) = 0;
+	virtual const Cell &cell(Pos pos) const = 0;
+	virtual void set_cell(Pos pos, std::string_view ch, std::size_t width, Look lk=look::Default) = 0;
+};
+
+struct Screen : public RegionI
+{
+	Screen(int fd);
+	~Screen();
+
+	using RegionI::invalidate;
+	using RegionI::clear;
+	using RegionI::print;
+
+	// a part of the screen; it's not adjusted when the screen is resized (see Region::set_bounds())
+	Region region(Rectangle rect);
+
+	void invalidate(Rectangle rect) override;
+
+	void clear(Color bg, Color fg=color::NoChange) override;
+	void clear(const Rectangle &rect, Color bg, Color fg=color::NoChange) override;
+
+	void go_to(Pos pos) override;
+	inline Pos cursor() const override { return _client_cursor; }
+	std::size_t print(Pos pos, std::string_view s, Look lk=look::Default) override;
+
+	using RegionI::blit;
+	void blit(const Surface &src, Rectangle src_rect, Pos pos) override;
+
+	// limits for an update (zero = no limit); when exhausted, the update stops
+	//   and the next update continues from there. not used by the render thread (see set_threaded())
+	struct Budget
+	{
+		std::chrono::microseconds time { 0 };
+		std::size_t bytes { 0 };
+	};
+	inline void update() { update(Budget{}); }
+	void update(Budget budget);
+	// whether anything was drawn (or invalidated) since the last update
+	inline bool dirty() const { return _dirty; }
+
+	// if enabled, the terminal is updated by a separate thread;
+	//   update() then only hands over the changes, i.e. it never waits for the terminal
+	void set_threaded(bool threaded);
+	inline bool threaded() const { return bool(_renderer); }
+	// on very large screens, bands of rows are compared concurrently; at most this many (default: one per CPU, at most 8)
+	void set_max_bands(std::size_t max_bands);
+	inline std::size_t max_bands() const { return _max_bands; }
+
+	// updates skipped (or merged with later ones) because the terminal couldn't keep up
+	inline std::size_t frames_dropped() const { return _frames_dropped; }
+
+	// output is written without blocking; what the terminal didn't accept (yet) is pending,
+	//   and is written before anything else when it's writable again (see output_poll())
+	inline std::size_t pending_output() const { return _pending_output; }
+	// write as much of the pending output as the terminal accepts now; returns whether all of it was written
+	bool write_pending();
+	// wait until all pending output was written, but at most 'timeout'
+	bool drain_output(std::chrono::milliseconds timeout);
+	// what to wait for, before more of the pending output can be written
+	::pollfd output_poll() const;
+
+	// write the output asynchronously, using io_uring (if available); returns whether it's used.
+	//   the write in flight also counts as pending output, its completion is collected by write_pending().
+	//   an update meanwhile is queued behind it (only one; further ones are dropped until it's submitted)
+	bool set_io_uring(bool enabled);
+	inline bool io_uring() const { return bool(_uring); }
+
+	// layers are composited on top of each other, in the order they were added, over the base layer (0).
+	//   cells with a color::Transparent background show what's below (only the background if it has content).
+	//   drawing (print(), clear(), Canvas, etc.) always goes to the selected layer
+	using LayerId = std::size_t;
+	LayerId add_layer(bool visible=true);
+	void remove_layer(LayerId id);
+	void show_layer(LayerId id, bool visible=true);
+	inline void hide_layer(LayerId id) { show_layer(id, false); }
+	void select_layer(LayerId id);
+	inline LayerId selected_layer() const { return _target == 0? 0: _layers[_target - 1].id; }
 
 	void set_size(Size size);
-	inline Size size() const { return _back_buffer.size(); }
-	inline Rectangle rect() const { return { { 0, 0 }, size() }; }
+	inline Size size() const override { return _back_buffer.size(); }
 
-	std::size_t measure(std::string_view s) const;
+	// forget what the terminal shows (e.g. after it was resized several times);
+	//   the next update erases the terminal and writes everything
+	void repaint();
 
 	Cell pick(Pos pos) const;
 
+	// terminal features that may be used when updating (see term::capabilities())
+	Capabilities capabilities;
+
+protected:
+	Cell &cell(Pos pos) override;
+	const Cell &cell(Pos pos) const override;
+	void set_cell(Pos pos, std::string_view ch, std::size_t width, Look lk=look::Default) override;
+
 private:
-	friend struct Canvas;  // direct access to internals
+	friend struct Region;
 	friend struct App;     // for get_terminal_size()  :(
 
 	Size get_terminal_size();
-	Cell &cell(Pos pos);
-	const Cell &cell(Pos pos) const;
-	void set_cell(Pos pos, std::string_view ch, std::size_t width, Look lk=look::Default);
-	Pos cursor_move(Pos pos);
-	void cursor_style(Style style);
-	void cursor_set_look(Look lk);
-
-	void _out(const std::string_view text);
-	void flush_buffer();
+	std::size_t print_clipped(const Rectangle &area, Pos &cursor, Pos pos, std::string_view s, Look lk);
+	inline ScreenBuffer &target() { return _target > 0? _layers[_target - 1].buffer: (_layered? _base: _back_buffer); }
+	inline const ScreenBuffer &target() const { return _target > 0? _layers[_target - 1].buffer: (_layered? _base: _back_buffer); }
+	void compose();
+	Cell composite(Pos pos) const;
+	struct Output;
+	bool render(ScreenBuffer &back, Budget budget);
+	std::size_t render_bands(ScreenBuffer &back, std::size_t num_bands);
+	void render_band(ScreenBuffer &back, std::size_t band, std::size_t band_height);
+	void band_worker(std::size_t band);
+	std::size_t render_rows(ScreenBuffer &back, std::size_t first_row, std::size_t end_row, Output &out);
+	bool output_congested() const;
+	bool output_ready();
+	void wait_for_terminal(int wake_fd);
+	bool write_unwritten();
+	void submit_output(bool pending_only);
+	bool wait_output(std::chrono::milliseconds timeout);
+	void publish();
+	std::unique_lock<std::mutex> pause_renderer();
+	void erase_screen(ScreenBuffer &back);
+	void scroll_rows(ScreenBuffer &back);
+	bool shift_cells(const ScreenBuffer &back, std::size_t y, std::size_t from, Output &out);
+	void flush_buffer(bool pending_only=false);
 
 
 private:
 	Pos _client_cursor { 0, 0 };
 
 	ScreenBuffer _back_buffer;
-	ScreenBuffer _front_buffer; // are multiple layers needed also here?
+	ScreenBuffer _front_buffer;
 	bool _dirty { false };
+	std::size_t _updates { 0 };  // completed updates
+	std::vector<Rectangle> _damage;  // invalidated areas, to be compared on next update
 
-	struct Cursor
+	struct Layer
 	{
-		Pos position { 0, 0 };
-		Look look;
-	} _cursor;
+		LayerId id;
+		ScreenBuffer buffer;  // its dirty spans are what needs to be composited again
+		bool visible;
+	};
+	std::vector<Layer> _layers;    // bottom to top
+	ScreenBuffer _base;            // the base layer; only used while there are other layers (otherwise the back buffer is drawn on)
+	bool _layered { false };
+	std::size_t _target { 0 };     // index of the selected layer + 1, or 0 for the base layer
+	LayerId _next_layer_id { 1 };
+	std::size_t _frames_dropped { 0 };
+	std::size_t _resume_row { 0 };  // where the next update starts (after running out of budget)
+
+	// output for the terminal, and the state the terminal's cursor will be in after it
+	struct Output
+	{
+		Pos cursor_move(Pos pos);
+		std::size_t cursor_move_cost(Pos pos) const;
+		void cursor_bridge(const ScreenBuffer &back, Pos pos);
+		void cursor_set_look(Look lk);
+		inline void out(const std::string_view text) { buffer.append(text); }
+		inline void out(char c) { buffer += c; }
+		// control sequences, written in place (no temporary strings)
+		void csi(std::size_t n, char command);
+		void csi(std::size_t n1, std::size_t n2, char command);
+		void csi_n(std::size_t n, char command);  // the default (1) is omitted
+		void number(std::size_t n);
+		void color(Color c, bool background);
+
+		std::string buffer;  // cleared (not freed) after each write; reserved up front
+
+		struct Cursor
+		{
+			Pos position { 0, 0 };
+			Look look;
+		} cursor;
+
+		std::size_t width { 0 };  // of the screen
+	};
+	Output _output;
+	std::size_t _max_bands { 1 };
+
+	// the threads rendering all but the first band, when there's more than one (see render_bands())
+	struct BandWorkers;
+	std::unique_ptr<BandWorkers> _band_workers;
 
-	std::string _output_buffer;
 	const int _fd { 0 };
+	const int _out_fd { 0 };  // a non-blocking file description of the same terminal, if possible (otherwise '_fd')
+	std::string _unwritten;   // output not accepted by the terminal (yet)
+	std::atomic<std::size_t> _pending_output { 0 };  // its size, readable by any thread
+
+	// the render thread, when enabled; it owns the front buffer, cursor and output buffer
+	struct Renderer;
+	std::unique_ptr<Renderer> _renderer;
+
+	// the io_uring writer, when enabled
+	//   (declared after what it's writing, so it's destroyed, i.e. its write cancelled, before that is released)
+	std::string _in_flight;  // what it's writing
+	std::unique_ptr<UringWriter> _uring;
+};
+
+// a part of the screen, with its own coordinates and cursor; drawing on it is clipped to its bounds
+struct Region : public RegionI
+{
+	using RegionI::invalidate;
+	using RegionI::clear;
+	using RegionI::print;
+
+	Size size() const override;
+
+	// position and size on the screen
+	inline Rectangle bounds() const { return _bounds; }
+	void set_bounds(Rectangle bounds);
+
+	// a part of this region
+	Region region(Rectangle rect) const;
+
+	void invalidate(Rectangle rect) override;
+
+	void clear(Color bg, Color fg=color::NoChange) override;
+	void clear(const Rectangle &rect, Color bg, Color fg=color::NoChange) override;
+
+	void go_to(Pos pos) override;
+	inline Pos cursor() const override { return _cursor; }
+	std::size_t print(Pos pos, std::string_view s, Look lk=look::Default) override;
+
+	using RegionI::blit;
+	void blit(const Surface &src, Rectangle src_rect, Pos pos) override;
+
+	// whether it was drawn on (or invalidated) since the screen was last updated,
+	//   i.e. it's independent of other regions
+	inline bool dirty() const { return _drawn > _screen._updates; }
+
+protected:
+	Cell &cell(Pos pos) override;
+	const Cell &cell(Pos pos) const override;
+	void set_cell(Pos pos, std::string_view ch, std::size_t width, Look lk=look::Default) override;
+
+private:
+	friend struct Screen;
+	Region(Screen &screen, Rectangle bounds);
+
+	// the part that's actually on the screen, in screen coordinates
+	inline Rectangle area() const { return _bounds.intersection(_screen.rect()); }
+	inline Pos to_screen(Pos pos) const { return { _bounds.top_left.x + pos.x, _bounds.top_left.y + pos.y }; }
+	inline void drawn() { _drawn = _screen._updates + 1; }
+
+private:
+	Screen &_screen;
+	Rectangle _bounds;
+	Pos _cursor { 0, 0 };
+	std::size_t _drawn { 0 };  // (the screen's update count + 1, when drawn on)
 };
 
-//struct Region : public RegionI
-//{
-//	void clear() override;
-//	void clear(Color bg, Color fg) override;
-//	void clear(const Rectangle &rect, Color bg, Color fg) override;
-//	void go_to(Pos pos) override;
-//	std::size_t print(std::string_view s, Color fg, Color bg, Style style) override;
-//	std::size_t print(Alignment align, Pos anchor_pos, std::string_view s, Color fg, Color bg, Style style) override;
-//	std::size_t print(Pos pos, std::string_view s, Color fg, Color bg, Style style) override;
-
-//private:
-//	Region(Screen &screen, Rectangle rect);
-
-//private:
-//	Screen &_screen;
-//	Rectangle _rect;
-//};
+// an offscreen drawing surface; e.g. draw an expensive widget once, then blit() it every frame
+struct Surface : public RegionI
+{
+	using RegionI::invalidate;
+	using RegionI::clear;
+	using RegionI::print;
+	using RegionI::blit;
+
+	Surface(Size size);
+
+	void set_size(Size size);
+	inline Size size() const override { return _buffer.size(); }
+
+	inline void invalidate(Rectangle) override {}  // (nothing to compare)
+
+	void clear(Color bg, Color fg=color::NoChange) override;
+	void clear(const Rectangle &rect, Color bg, Color fg=color::NoChange) override;
+
+	inline void go_to(Pos pos) override { _cursor = pos; }
+	inline Pos cursor() const override { return _cursor; }
+	std::size_t print(Pos pos, std::string_view s, Look lk=look::Default) override;
+
+	void blit(const Surface &src, Rectangle src_rect, Pos pos) override;
+
+	inline const ScreenBuffer &buffer() const { return _buffer; }
+
+protected:
+	inline Cell &cell(Pos pos) override { return _buffer.cell(pos); }
+	inline const Cell &cell(Pos pos) const override { return _buffer.cell(pos); }
+	void set_cell(Pos pos, std::string_view ch, std::size_t width, Look lk=look::Default) override;
+
+private:
+	ScreenBuffer _buffer;
+	Pos _cursor { 0, 0 };
+};
 
 
 } // NS: termic
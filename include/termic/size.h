@@ -2,6 +2,7 @@
 
 #include <cstdint>
 #include <utility>
+#include <algorithm>
 
 namespace termic
 {
@@ -83,6 +84,41 @@ struct Rectangle
 	{
 		return top_left.x + size.width - 1;
 	}
+
+	inline bool empty() const
+	{
+		return size.width == 0 or size.height == 0;
+	}
+
+	// the area covered by both rectangles (empty if they don't overlap)
+	inline Rectangle intersection(const Rectangle &r) const
+	{
+		const auto left = std::max(top_left.x, r.top_left.x);
+		const auto top = std::max(top_left.y, r.top_left.y);
+		const auto end_x = std::min(top_left.x + size.width, r.top_left.x + r.size.width);
+		const auto end_y = std::min(top_left.y + size.height, r.top_left.y + r.size.height);
+
+		if(end_x <= left or end_y <= top)
+			return { { left, top }, { 0, 0 } };
+
+		return { { left, top }, { end_x - left, end_y - top } };
+	}
+
+	// the smallest rectangle covering both rectangles
+	inline Rectangle united(const Rectangle &r) const
+	{
+		if(r.empty())
+			return *this;
+		if(empty())
+			return r;
+
+		const auto left = std::min(top_left.x, r.top_left.x);
+		const auto top = std::min(top_left.y, r.top_left.y);
+		const auto end_x = std::max(top_left.x + size.width, r.top_left.x + r.size.width);
+		const auto end_y = std::max(top_left.y + size.height, r.top_left.y + r.size.height);
+
+		return { { left, top }, { end_x - left, end_y - top } };
+	}
 };
 
 
@@ -2,6 +2,9 @@
 
 #include <termic/size.h>
 
+#include <string>
+#include <string_view>
+
 namespace termic
 {
 
@@ -13,6 +16,8 @@ enum Options
 	MouseMoveEvents   = 1 << 2,
 	MouseEvents       = MouseButtonEvents | MouseMoveEvents,
 	FocusEvents       = 1 << 3,
+	RenderThread      = 1 << 4,  // update the terminal on a separate thread (see Screen::set_threaded())
+	IoUring           = 1 << 5,  // write to the terminal asynchronously, if io_uring is available (see Screen::set_io_uring())
 	NoSignalDecode    = 1 << 16,
 };
 
@@ -22,6 +27,13 @@ inline Options operator | (Options a, Options b)
 	return static_cast<Options>(static_cast<int>(a) | static_cast<int>(b));
 }
 
+// optional terminal features, detected by term::init()
+struct Capabilities
+{
+	bool repeat_char { false };  // REP: repeat the preceding character
+	bool synchronized_output { false };  // mode 2026: render output between start & end markers atomically
+};
+
 namespace term
 {
 
@@ -30,6 +42,13 @@ void restore(int in_fd, int out_fd);
 
 Size get_size(int fd);
 
+const Capabilities &capabilities();
+// input read by init() (while waiting for the terminal's replies) that wasn't a reply, e.g. keys typed meanwhile
+std::string take_early_input();
+// the capabilities according to the terminal's replies to the queries sent by init() (and the device attributes reply ending them).
+//   what's not a reply is appended to 'input'
+Capabilities parse_capabilities(std::string_view response, std::string &input);
+
 } // NS: term
 
 } // NS: termicic
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <sys/uio.h>
+
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+namespace termic
+{
+
+// writes to a file descriptor asynchronously, using io_uring (via raw system calls; Linux 5.6+).
+//   only one write is in flight at a time, which keeps the output in order
+struct UringWriter
+{
+	UringWriter(int fd);
+	~UringWriter();  // cancels the write in flight (and waits until it's cancelled)
+
+	UringWriter(const UringWriter &) = delete;
+	UringWriter &operator = (const UringWriter &) = delete;
+
+	// whether io_uring is available (and set up)
+	inline explicit operator bool() const { return _ring_fd >= 0; }
+
+	// start writing 'parts' (at most 'max_parts'); the data must stay valid until the write completed.
+	//   must not be busy()
+	void submit(const ::iovec *parts, std::size_t num_parts);
+	// collect the completion of the write in flight, if there is one (a partial write is continued);
+	//   returns whether a write is still in flight
+	bool busy();
+	// bytes of the write in flight that aren't written yet
+	std::size_t remaining() const;
+	// writes that failed (their data was dropped)
+	inline std::size_t errors() const { return _errors; }
+
+	// readable when a write completed (i.e. busy() should be called)
+	inline int fd() const { return _ring_fd; }
+
+	static constexpr std::size_t max_parts { 4 };
+
+private:
+	void submit_parts(bool wait_writable);
+	void enter();
+	void cancel();
+
+private:
+	const int _fd;
+	int _ring_fd { -1 };
+
+	void *_ring { nullptr };
+	std::size_t _ring_size { 0 };
+	io_uring_sqe *_sqes { nullptr };
+	std::size_t _sqes_size { 0 };
+
+	unsigned *_sq_tail { nullptr };
+	unsigned *_sq_mask { nullptr };
+	unsigned *_sq_array { nullptr };
+	unsigned *_cq_head { nullptr };
+	unsigned *_cq_tail { nullptr };
+	unsigned *_cq_mask { nullptr };
+	io_uring_cqe *_cqes { nullptr };
+
+	// the write in flight
+	::iovec _parts[max_parts];
+	std::size_t _first_part { 0 };
+	std::size_t _num_parts { 0 };
+	bool _in_flight { false };
+	unsigned _completions_due { 0 };  // CQEs to collect before the write is done (a poll might precede it)
+	unsigned _unsubmitted { 0 };      // SQEs the kernel didn't take (yet)
+	unsigned _empty_writes { 0 };     // consecutive writes that accepted nothing
+	std::size_t _errors { 0 };
+};
+
+} // NS: termic
@@ -28,6 +28,13 @@ App::App(Options opts) :
 
 	term::init(STDIN_FILENO, STDOUT_FILENO, opts);
 	_initialized = true;
+	_input.unread(term::take_early_input());
+
+	_screen.capabilities = term::capabilities();
+	if((opts & RenderThread) > 0)
+		_screen.set_threaded(true);
+	if((opts & IoUring) > 0)
+		_screen.set_io_uring(true);
 
 	::atexit(app_atexit);
 	std::signal(SIGINT, signal_received);
@@ -80,19 +87,9 @@ int App::run()
 		{
 			_emit_resize_event = false;
 
-			const auto old_size = _screen.size();
-			const auto first_resize = old_size.empty();
-
-			const auto new_size = _screen.get_terminal_size();
-
-			_screen.set_size(new_size);
+			const auto first_resize = _screen.size().empty();
 
-			dispatch_event(event::Resize{
-				.size = new_size,
-				.old = {
-					.size = old_size,
-				},
-			});
+			resize_screen(false);
 
 			// the first resize event also means that we've just started
 			if(first_resize)
@@ -102,7 +99,28 @@ int App::run()
 				_screen.update();
 		}
 
-		for(const auto &event: _input.read())
+		_resize.signalled(_resize_signals.exchange(0), std::chrono::steady_clock::now());
+
+		if(const auto due = _resize.due(std::chrono::steady_clock::now()); due != ResizeDebouncer::NotDue)
+			resize_screen(due == ResizeDebouncer::Intermediate);
+
+		// if an update was postponed (or dropped), don't wait longer than until it's due
+		std::optional<std::chrono::microseconds> timeout;
+		if(_update_continues)
+			timeout = 0us;  // only check for input, then continue the update
+		else if(_screen.dirty())
+			timeout = _pacer.wait(std::chrono::steady_clock::now());
+
+		// nor longer than until a (debounced) resize is due
+		if(const auto until_due = _resize.wait(std::chrono::steady_clock::now()))
+			timeout = timeout? std::min(*timeout, *until_due): *until_due;
+
+		// output the terminal didn't accept is resumed when it's writable again
+		//   (the render thread does that by itself)
+		const bool output_pending = _screen.pending_output() > 0 and not _screen.threaded();
+		_input.watch_output(output_pending? _screen.output_poll(): ::pollfd{ .fd = -1, .events = 0, .revents = 0 });
+
+		for(const auto &event: _input.read(timeout))
 		{
 			const auto *mm = std::get_if<event::MouseMove>(&event);
 			if(mm != nullptr)
@@ -117,14 +135,81 @@ int App::run()
 			dispatch_event(event);
 		}
 
-		_screen.update();
+		if(output_pending)
+			_screen.write_pending();
+
+		// the screen doesn't match the terminal's (new) size; wait for the resize
+		if(_resize.burst() == 0)
+			update_screen();
 	}
 
 	if(g_log) fmt::print(g_log, "\x1b[33;1mApp:loop exiting\x1b[m\n");
 
+	// let the render thread finish, and the terminal accept the output, before it's restored
+	_screen.set_threaded(false);
+	_screen.drain_output(1s);
+
 	return 0;
 }
 
+void App::set_max_fps(std::size_t fps)
+{
+	_pacer.interval = fps > 0? std::chrono::microseconds(1'000'000 / fps): 0us;
+}
+
+void App::set_update_budget(std::chrono::microseconds budget)
+{
+	_update_budget = budget;
+}
+
+void App::set_resize_debounce(std::chrono::milliseconds settle, std::chrono::milliseconds intermediate)
+{
+	_resize.settle = settle;
+	_resize.intermediate = intermediate;
+}
+
+void App::resize_screen(bool intermediate)
+{
+	const auto old_size = _screen.size();
+	const auto new_size = _screen.get_terminal_size();
+
+	_screen.set_size(new_size);
+
+	// (after a burst of resizes, what the terminal shows is unknown)
+	if(_resize.resized(std::chrono::steady_clock::now(), intermediate))
+		_screen.repaint();
+
+	dispatch_event(event::Resize{
+		.size = new_size,
+		.old = {
+			.size = old_size,
+		},
+		.intermediate = intermediate,
+	});
+}
+
+void App::update_screen()
+{
+	if(not _screen.dirty())
+		return;
+
+	const auto now = std::chrono::steady_clock::now();
+
+	// too soon; postpone it, so more changes can be collected into the same update
+	if(not _pacer.due(now, _update_continues))
+		return;
+
+	const auto dropped = _screen.frames_dropped();
+
+	_screen.update(Screen::Budget{ _update_budget });
+
+	if(not _update_continues)
+		_pacer.updated(now);
+
+	// the budget ran out before everything was written
+	_update_continues = _screen.dirty() and _screen.frames_dropped() == dropped;
+}
+
 void App::trigger_render()
 {
 	_input.trigger_render();
@@ -176,7 +261,7 @@ void signal_received(int signum)
 	if(signum == SIGWINCH)
 	{
 		if(g_app)
-			g_app->_emit_resize_event = true;
+			++g_app->_resize_signals;  // (lock-free, i.e. safe in a signal handler)
 		return;
 	}
 
@@ -5,27 +5,29 @@
 
 #include <fmt/core.h>
 
+#include <utility>
+
 namespace termic
 {
 
 void Canvas::clear()
 {
-	_screen.clear();
+	_region.clear();
 }
 
 Size Canvas::size() const
 {
-	return _screen.size();
+	return _region.size();
 }
 
 void Canvas::fill(Color c)
 {
-	fill(_screen.rect(), c);
+	fill(_region.rect(), c);
 }
 
 void Canvas::fill(const color::Sampler *s, float sampler_angle)
 {
-	fill(_screen.rect(), s, sampler_angle);
+	fill(_region.rect(), s, sampler_angle);
 }
 
 void Canvas::fill(Rectangle rect, Color c)
@@ -41,7 +43,7 @@ void Canvas::fill(Rectangle rect, const color::Sampler *s, float sampler_angle)
 
 	// TODO: _scr.iterator(rect) ?
 
-	const auto size = _screen.size();
+	const auto size = _region.size();
 
 	for(auto y = rect.top_left.y; y <= rect.top_left.y + rect.size.height - 1 and y < size.height; y++)
 	{
@@ -50,15 +52,19 @@ void Canvas::fill(Rectangle rect, const color::Sampler *s, float sampler_angle)
 			const float u = static_cast<float>(x - rect.top_left.x + 1) / float(rect.size.width);
 			const float v = static_cast<float>(y - rect.top_left.y + 1) / float(rect.size.height);
 
-			_screen.set_cell({ x, y }, Cell::NoChange, 1, look::bg(s->sample({ u, v }, sampler_angle)));
+			// keep the width of (both halves of) double width characters
+			const auto &cell = std::as_const(_region).cell({ x, y });
+			const auto width = cell.ch[0] == '\0'? 1u: cell.width;
+
+			_region.set_cell({ x, y }, Cell::NoChange, width, look::bg(s->sample({ u, v }, sampler_angle)));
 		}
 	}
-	_screen.invalidate();
+	_region.invalidate(rect);
 }
 
 void Canvas::filter(std::function<void(Look &, UV)> f)
 {
-	filter(_screen.rect(), f);
+	filter(_region.rect(), f);
 }
 
 void Canvas::filter(Rectangle rect, std::function<void (Look &, UV)> f)
@@ -68,7 +74,7 @@ void Canvas::filter(Rectangle rect, std::function<void (Look &, UV)> f)
 
 	// TODO: _scr.iterator(rect) ?
 
-	const auto size = _screen.size();
+	const auto size = _region.size();
 
 	for(auto y = rect.top_left.y; y <= rect.top_left.y + rect.size.height - 1 and y < size.height; y++)
 	{
@@ -77,25 +83,26 @@ void Canvas::filter(Rectangle rect, std::function<void (Look &, UV)> f)
 			const float u = static_cast<float>(x - rect.top_left.x + 1) / float(rect.size.width);
 			const float v = static_cast<float>(y - rect.top_left.y + 1) / float(rect.size.height);
 
-			auto &cell = _screen.cell({ x, y });
+			const auto &cell = std::as_const(_region).cell({ x, y });
 			Look lk { cell.look };
 
 			f(lk, UV{ u, v });
 
-			cell.look = lk;
+			// via set_cell() to keep the row hash up to date
+			_region.set_cell({ x, y }, Cell::NoChange, cell.width, lk);
 		}
 	}
-	_screen.invalidate();
+	_region.invalidate(rect);
 }
 
 void Canvas::fade(float blend)
 {
-	fade(_screen.rect(), color::Black, color::Black, blend);
+	fade(_region.rect(), color::Black, color::Black, blend);
 }
 
 void Canvas::fade(Color fg, Color bg, float blend)
 {
-	fade(_screen.rect(), fg, bg, blend);
+	fade(_region.rect(), fg, bg, blend);
 }
 
 void Canvas::fade(Rectangle rect, float blend)
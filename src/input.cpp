@@ -53,8 +53,15 @@ void Input::set_double_click_duration(std::chrono::milliseconds duration)
     _double_click_duration = static_cast<float>(std::max(10L, duration.count()))/1000.f;
 }
 
-Input::WaitResult Input::wait()
+Input::WaitResult Input::wait(std::optional<microseconds> timeout)
 {
+	::timespec timeout_ts;
+	if(timeout)
+	{
+		const auto us = std::max(0L, timeout->count());
+		timeout_ts = { .tv_sec = us / 1'000'000, .tv_nsec = (us % 1'000'000) * 1'000 };
+	}
+
 	while(true)
 	{
 		::pollfd pollfds[sizeof(_pollfds)/sizeof(_pollfds[0])];
@@ -74,9 +81,11 @@ Input::WaitResult Input::wait()
 		sigset_t sigs;
 		sigemptyset(&sigs);
 
-		int rc = ::ppoll(pollfds, first_timer_fd_idx + timers_enabled, nullptr, &sigs);
+		int rc = ::ppoll(pollfds, first_timer_fd_idx + timers_enabled, timeout? &timeout_ts: nullptr, &sigs);
 		if(rc == -1 and errno == EINTR)  // something more urgent came up
 			return SignalReceived;
+		if(rc == 0)
+			return TimedOut;
 
 		// first check input stream
 		if(pollfds[input_fd_idx].revents > 0)
@@ -90,6 +99,10 @@ Input::WaitResult Input::wait()
 			return RenderTriggered;
 		}
 
+		// output is pending, and more can be written now
+		if(pollfds[output_fd_idx].revents > 0)
+			return OutputReady;
+
 		// then check timers
 		// TODO: use epoll, it can return the signalled fd's directly, I think?
 		//   with (p)poll we need to this linear search
@@ -263,18 +276,19 @@ void Input::build_pollfds()
 	// '_timers_lock' must already be locked
 
 	// our input stream is always pollfd 0
-	_pollfds[0] = {
+	_pollfds[input_fd_idx] = {
 		.fd = STDIN_FILENO,  // TODO: '_in' when it's a file descriptor
 		.events = POLLIN,
 		.revents = 0,
 	};
-	_pollfds[1] = {
+	_pollfds[trigger_fd_idx] = {
 		.fd = _render_trigger_fd,
 		.events = POLLIN,
 		.revents = 0,
 	};
+	_pollfds[output_fd_idx] = _output_poll;  // ignored by poll when its fd is negative
 
-	std::size_t idx { 2 };
+	std::size_t idx { first_timer_fd_idx };
 	for(const auto &[_, fd]: _timer_id_fd)
 	{
 		_pollfds[idx] = {
@@ -286,7 +300,20 @@ void Input::build_pollfds()
 		++idx;
 	}
 
-	if(g_log) fmt::print(g_log, "Input: timers enabled: {}\n", idx - 2);
+	if(g_log) fmt::print(g_log, "Input: timers enabled: {}\n", idx - first_timer_fd_idx);
+}
+
+void Input::unread(std::string_view chars)
+{
+	_unread.append(chars);
+}
+
+void Input::watch_output(::pollfd output)
+{
+	std::lock_guard _(_timers_lock);
+
+	_output_poll = output;
+	_pollfds[output_fd_idx] = output;
 }
 
 void Input::cancel_all_timers()
@@ -310,32 +337,34 @@ void Timer::cancel()
 		App::the().timer.cancel(*this);
 }
 
-std::vector<event::Event> Input::read()
+std::vector<event::Event> Input::read(std::optional<microseconds> timeout)
 {
 	// TODO: use file descriptor instead:
 	//std::size_t avail { 0 };
 	//::ioctl(_in, FIONREAD, &avail);
-	if(_in.rdbuf()->in_avail() == 0) // TODO: use file descriptor instead
+	if(_in.rdbuf()->in_avail() == 0 and _unread.empty()) // TODO: use file descriptor instead
 	{
 		// no data yet, wait for data to arrive (or something else to happen)
 
-		const auto result = wait();
-		if(result == TimerTriggered or result == SignalReceived)
+		const auto result = wait(timeout);
+		if(result == TimerTriggered or result == SignalReceived or result == OutputReady or result == TimedOut)
 			return {};
 		if(result == RenderTriggered)
 			return { event::Render{} };
 	}
 
+	// what was put back (or unread) goes first
 	std::string in;
-	in.resize(std::size_t(_in.rdbuf()->in_avail()));  // TODO: use file descriptor instead
+	std::swap(in, _unread);
+
+	const auto unread_size = in.size();
+	in.resize(unread_size + std::size_t(_in.rdbuf()->in_avail()));  // TODO: use file descriptor instead
 
-	_in.read(in.data(), int(in.size()));  // TODO: use file descriptor instead
+	_in.read(in.data() + unread_size, int(in.size() - unread_size));  // TODO: use file descriptor instead
 
 	auto revert = [this](const std::string_view chars) {
-		// put the read bytes back into the buffer (we'll read them next time)
-		// TODO: use file descriptor instead
-		for(auto iter = chars.rbegin(); iter != chars.rend(); iter++)
-			_in.putback(*iter);
+		// put the read bytes back (we'll parse them next time)
+		_unread.assign(chars);
 	};
 
 
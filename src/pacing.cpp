@@ -0,0 +1,67 @@
+#include <termic/pacing.h>
+
+#include <algorithm>
+
+
+namespace termic
+{
+
+bool FramePacer::due(Clock::time_point now, bool continues) const
+{
+	// too soon; postpone it, so more changes can be collected into the same update
+	return continues or now >= _last_frame + interval;
+}
+
+std::chrono::microseconds FramePacer::wait(Clock::time_point now) const
+{
+	const auto until_due = std::chrono::duration_cast<std::chrono::microseconds>(_last_frame + interval - now);
+	return std::max(until_due, min_wait);
+}
+
+void ResizeDebouncer::signalled(std::size_t signals, Clock::time_point now)
+{
+	if(signals == 0)
+		return;
+
+	_burst += signals;
+	_pending = true;
+	_last_signal = now;
+}
+
+ResizeDebouncer::Due ResizeDebouncer::due(Clock::time_point now) const
+{
+	if(not _pending)
+		return NotDue;
+
+	if(now - _last_signal >= settle)
+		return Final;
+	if(intermediate > 0ms and _burst > 0 and now - _last_resize >= intermediate)
+		return Intermediate;
+	return NotDue;
+}
+
+bool ResizeDebouncer::resized(Clock::time_point now, bool intermediate_resize)
+{
+	// after several resizes, the terminal might have been smaller in between, i.e. what it shows is unknown
+	const auto repaint = _burst > 1;
+
+	_burst = 0;
+	_pending = intermediate_resize;  // the final one is still to come
+	_last_resize = now;
+
+	return repaint;
+}
+
+std::optional<std::chrono::microseconds> ResizeDebouncer::wait(Clock::time_point now) const
+{
+	if(not _pending)
+		return {};
+
+	auto due_at = _last_signal + settle;
+	if(intermediate > 0ms and _burst > 0)
+		due_at = std::min(due_at, _last_resize + intermediate);
+
+	return std::max(0us, std::chrono::duration_cast<std::chrono::microseconds>(due_at - now));
+}
+
+} // NS: termic
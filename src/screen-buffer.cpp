@@ -2,6 +2,7 @@
 
 #include <fmt/core.h>
 
+#include <type_traits>
 #include <assert.h>
 
 
@@ -9,8 +10,86 @@ namespace termic
 {
 extern std::FILE *g_log;
 
+// (rows are copied as plain memory)
+static_assert(std::is_trivially_copyable_v<Cell>);
+
+static inline std::uint64_t mix(std::uint64_t h)
+{
+	// splitmix64 finalizer
+	h ^= h >> 30;
+	h *= 0xbf58476d1ce4e5b9ull;
+	h ^= h >> 27;
+	h *= 0x94d049bb133111ebull;
+	h ^= h >> 31;
+	return h;
+}
+
+// hash of a cell at a specific column; a row's hash is all its cell hashes XOR:ed together,
+//   which means a single cell can be replaced without touching the rest of the row
+static inline std::uint64_t cell_hash(const Cell &cell, std::size_t x)
+{
+	std::uint64_t ch { 0 };
+	for(auto idx = 0u; idx < sizeof(cell.ch) - 1 and cell.ch[idx] != '\0'; ++idx)
+		ch |= std::uint64_t(static_cast<std::uint8_t>(cell.ch[idx])) << (idx*8);
+
+	const auto content = ch | std::uint64_t(cell.width) << 32 | std::uint64_t(cell.look.style & 0xff) << 40 | std::uint64_t(x) << 48;
+	const auto colors = std::uint64_t(cell.look.fg) | std::uint64_t(cell.look.bg) << 32;
+
+	return mix(content ^ mix(colors));
+}
+
+void ScreenBuffer::rehash(std::size_t y) const
+{
+	if(_row_epochs[y] != _epoch)
+	{
+		// no need to materialize it just for this
+		_row_hashes[y] = _cleared_hash;
+		_stale_hashes[y] = false;
+		return;
+	}
+
+	std::uint64_t hash { 0 };
+
+	const auto *row = _buffer.data() + y*_width;
+	for(auto x = 0u; x < _width; ++x)
+		hash ^= cell_hash(row[x], x);
+
+	_row_hashes[y] = hash;
+	_stale_hashes[y] = false;
+}
+
+void ScreenBuffer::clear_row(std::size_t y) const
+{
+	const auto row = _buffer.begin() + int(y*_width);
+	std::fill(row, row + int(_width), _cleared);
+	_row_epochs[y] = _epoch;
+}
+
 void ScreenBuffer::clear(Color bg, Color fg, bool content)
 {
+	if(content and fg != color::NoChange and bg != color::NoChange)
+	{
+		// all cells become the same; just start a new epoch
+		++_epoch;
+
+		_cleared = Cell{};
+		_cleared.width = 1;
+		_cleared.look = { fg, style::Default, bg };
+
+		_cleared_hash = 0;
+		for(auto x = 0u; x < _width; ++x)
+			_cleared_hash ^= cell_hash(_cleared, x);
+
+		std::fill(_row_hashes.begin(), _row_hashes.end(), _cleared_hash);
+		std::fill(_stale_hashes.begin(), _stale_hashes.end(), false);
+
+		mark_dirty();
+		return;
+	}
+
+	for(auto y = 0u; y < _height; ++y)
+		materialize(y);
+
 	for(auto &cell: _buffer)
 	{
 		if(content)
@@ -24,6 +103,10 @@ void ScreenBuffer::clear(Color bg, Color fg, bool content)
 		if(bg != color::NoChange)
 			cell.look.bg = bg;
 	}
+
+	mark_dirty();
+
+	std::fill(_stale_hashes.begin(), _stale_hashes.end(), true);
 }
 
 void ScreenBuffer::clear(Rectangle rect, Color bg, Color fg, bool content)
@@ -37,12 +120,23 @@ void ScreenBuffer::clear(Rectangle rect, Color bg, Color fg, bool content)
 
 	for(auto y = rect.top_left.y; y <= rect.top_left.y + rect.size.height - 1 and y < height; ++y, std::advance(row_iter, _width))
 	{
+		materialize(y);
+
 		auto col_iter = row_iter + int(rect.top_left.x);
 
+		if(rect.top_left.x < width)
+			mark_dirty(y, rect.top_left.x, std::min(rect.right(), width - 1));
+
+		auto &hash = _row_hashes[y];
+		const bool stale = _stale_hashes[y];
+
 		for(auto x = rect.top_left.x; x <= rect.top_left.x + rect.size.width - 1 and x < width; ++x, ++col_iter)
 		{
 			auto &cell = *col_iter;
 
+			if(not stale)
+				hash ^= cell_hash(cell, x);
+
 			if(content)
 			{
 				cell.ch[0] = '\0';
@@ -53,6 +147,9 @@ void ScreenBuffer::clear(Rectangle rect, Color bg, Color fg, bool content)
 			cell.look.style = style::Default;
 			if(bg != color::NoChange)
 				cell.look.bg = bg;
+
+			if(not stale)
+				hash ^= cell_hash(cell, x);
 		}
 	}
 }
@@ -62,7 +159,14 @@ void ScreenBuffer::set_cell(Pos pos, std::string_view ch, std::size_t width, Loo
 	if(pos.x >= _width or pos.y >= _height)
 		return;
 
-	auto &cell = this->cell(pos);
+	materialize(pos.y);
+
+	auto &cell = _buffer[pos.y*_width + pos.x];
+	mark_dirty(pos.y, pos.x, pos.x);
+
+	const bool stale = _stale_hashes[pos.y];
+	if(not stale)
+		_row_hashes[pos.y] ^= cell_hash(cell, pos.x);  // remove the old cell from the row's hash
 
 	if(ch != Cell::NoChange)
 	{
@@ -81,82 +185,277 @@ void ScreenBuffer::set_cell(Pos pos, std::string_view ch, std::size_t width, Loo
 	if(lk.bg != color::NoChange)
 		cell.look.bg = lk.bg;
 
+	if(not stale)
+		_row_hashes[pos.y] ^= cell_hash(cell, pos.x);
 }
 
 ScreenBuffer &ScreenBuffer::operator = (const ScreenBuffer &src)
 {
 	assert(src.size().operator == (size()));
 
+	// NOTE: dirty state is not copied; it's relative to the buffer's own history
 	_buffer = src._buffer;
+	_row_hashes = src._row_hashes;
+	_stale_hashes = src._stale_hashes;
+	_epoch = src._epoch;
+	_row_epochs = src._row_epochs;
+	_cleared = src._cleared;
+	_cleared_hash = src._cleared_hash;
 
 	return *this;
 }
 
-void ScreenBuffer::set_size(Size new_size)
+void ScreenBuffer::scroll(std::size_t top, std::size_t bottom, int lines)
 {
-	const auto &[new_width, new_height] = new_size;
+	if(lines == 0 or top > bottom or bottom >= _height)
+		return;
 
-	if(new_width == _width and new_height == _height)
+	const auto shift = std::min(static_cast<std::size_t>(std::abs(lines)), bottom - top + 1);
+
+	const auto row = [this](std::size_t y) { return _buffer.begin() + int(y*_width); };
+	const auto hash = [this](std::size_t y) { return _row_hashes.begin() + int(y); };
+	const auto stale = [this](std::size_t y) { return _stale_hashes.begin() + int(y); };
+	const auto epoch = [this](std::size_t y) { return _row_epochs.begin() + int(y); };
+
+	// same as a cleared cell
+	Cell blank {};
+	blank.width = 1;
+
+	if(lines > 0)
+	{
+		std::copy(row(top + shift), row(bottom + 1), row(top));
+		std::copy(hash(top + shift), hash(bottom + 1), hash(top));
+		std::copy(stale(top + shift), stale(bottom + 1), stale(top));
+		std::copy(epoch(top + shift), epoch(bottom + 1), epoch(top));
+
+		std::fill(row(bottom + 1 - shift), row(bottom + 1), blank);
+		std::fill(stale(bottom + 1 - shift), stale(bottom + 1), true);
+		std::fill(epoch(bottom + 1 - shift), epoch(bottom + 1), _epoch);
+	}
+	else
+	{
+		std::copy_backward(row(top), row(bottom + 1 - shift), row(bottom + 1));
+		std::copy_backward(hash(top), hash(bottom + 1 - shift), hash(bottom + 1));
+		std::copy_backward(stale(top), stale(bottom + 1 - shift), stale(bottom + 1));
+		std::copy_backward(epoch(top), epoch(bottom + 1 - shift), epoch(bottom + 1));
+
+		std::fill(row(top), row(top + shift), blank);
+		std::fill(stale(top), stale(top + shift), true);
+		std::fill(epoch(top), epoch(top + shift), _epoch);
+	}
+
+	for(auto y = top; y <= bottom; ++y)
+		mark_dirty(y, 0, _width - 1);
+}
+
+void ScreenBuffer::shift_cells(std::size_t y, std::size_t x, int cells)
+{
+	if(cells == 0 or x >= _width or y >= _height)
 		return;
 
-	auto resized { false };
+	const auto shift = std::min(static_cast<std::size_t>(std::abs(cells)), _width - x);
 
-	if(preserve_content)
+	materialize(y);
+
+	const auto row = _buffer.begin() + int(y*_width);
+	const auto col = [&row](std::size_t cx) { return row + int(cx); };
+
+	// same as a cleared cell
+	Cell blank {};
+	blank.width = 1;
+
+	if(cells > 0)
 	{
-		const bool initial = _width == 0 and _height == 0;
+		std::copy_backward(col(x), col(_width - shift), col(_width));
+		std::fill(col(x), col(x + shift), blank);
+	}
+	else
+	{
+		std::copy(col(x + shift), col(_width), col(x));
+		std::fill(col(_width - shift), col(_width), blank);
+	}
+
+	_stale_hashes[y] = true;
+	mark_dirty(y, x, _width - 1);
+}
 
-		if(g_log) fmt::print(g_log, "resize: {}x{} -> {}x{}\n", _width, _height, new_width, new_height);
+void ScreenBuffer::copy_span(const ScreenBuffer &src, std::size_t y, Span span)
+{
+	assert(src.size().operator == (size()));
 
+	if(span.empty() or span.first >= _width)
+		return;
 
-		if(not initial and new_width != _width)
-		{
-			// width changed (i.e. row stride changed),
-			//   we need to copy each row from the original to the new size
-			const auto copy = _buffer;
+	src.materialize(y);
+	materialize(y);
 
-			// resize to 0 and then to new size, to force all cells to default  (is there a better way?)
-			_buffer.resize(0);
-			_buffer.resize(new_height*new_width);
-			resized = true;
+	const auto offset = y*_width;
+	const auto first = src._buffer.begin() + int(offset + span.first);
+	const auto last = src._buffer.begin() + int(offset + std::min(span.last, _width - 1) + 1);
+
+	std::copy(first, last, _buffer.begin() + int(offset + span.first));
+
+	_row_hashes[y] = src.row_hash(y);
+	_stale_hashes[y] = false;
+}
+
+void ScreenBuffer::blit(const ScreenBuffer &src, Rectangle src_rect, Pos pos)
+{
+	assert(&src != this);
+
+	src_rect = src_rect.intersection({ { 0, 0 }, src.size() });
+	if(src_rect.empty() or pos.x >= _width or pos.y >= _height)
+		return;
 
-			const auto copy_len = int(std::min(_width, new_width));
+	const auto width = std::min(src_rect.size.width, _width - pos.x);
+	const auto height = std::min(src_rect.size.height, _height - pos.y);
 
-			auto src_iter = copy.cbegin();
-			auto dst_iter = _buffer.begin();
-			for (auto y = 0u; y < std::min(new_height, _height); ++y, std::advance(dst_iter, new_width), std::advance(src_iter, _width))
-				std::copy(src_iter, src_iter + copy_len, dst_iter);
+	// whole rows, in the same columns, have the same hash
+	const bool whole_rows = width == _width and src._width == _width;
+
+	for(auto row = 0u; row < height; ++row)
+	{
+		const auto src_y = src_rect.top_left.y + row;
+		const auto y = pos.y + row;
+
+		src.materialize(src_y);
+		materialize(y);
+
+		const auto first = src._buffer.begin() + int(src_y*src._width + src_rect.top_left.x);
+		const auto dest = _buffer.begin() + int(y*_width + pos.x);
+		std::copy(first, first + int(width), dest);
+
+		// double width characters cut in half, at either side, are replaced by a space
+		auto span_first { pos.x };
+		auto span_last { pos.x + width - 1 };
+		const auto cut = [](Cell &cell) {
+			cell.ch[0] = ' ';
+			cell.ch[1] = '\0';
+			cell.width = 1;
+		};
+		if(dest->width == 0)
+			cut(*dest);
+		if((dest + int(width) - 1)->width > 1 and pos.x + width < _width)
+			cut(*(dest + int(width) - 1));
+		if(pos.x > 0 and (dest - 1)->width > 1)
+		{
+			cut(*(dest - 1));
+			--span_first;
 		}
+		if(pos.x + width < _width and (dest + int(width))->width == 0)
+		{
+			cut(*(dest + int(width)));
+			++span_last;
+		}
+
+		mark_dirty(y, span_first, span_last);
 
-		// set added rows to defaults
-		if(initial or new_height > _height)
+		if(whole_rows)
 		{
-			_buffer.resize(new_height*new_width);
-			resized = true;
+			_row_hashes[y] = src.row_hash(src_y);
+			_stale_hashes[y] = false;
+		}
+		else
+			_stale_hashes[y] = true;
+	}
+}
+
+void ScreenBuffer::mark_dirty()
+{
+	if(_width == 0)
+		return;
+
+	for(auto &span: _dirty_rows)
+		span = { 0, _width - 1 };
+}
+
+void ScreenBuffer::set_size(Size new_size)
+{
+	const auto &[new_width, new_height] = new_size;
+
+	if(new_width == _width and new_height == _height)
+		return;
+
+	if(preserve_content and g_log) fmt::print(g_log, "resize: {}x{} -> {}x{}\n", _width, _height, new_width, new_height);
+
+	// some room to grow, to avoid re-allocating on every step of an interactive resize
+	const auto num_cells = new_width*new_height;
+	if(num_cells > _buffer.capacity())
+		_buffer.reserve(num_cells + num_cells/4);
+
+	const auto kept_rows = preserve_content? std::min(_height, new_height): 0;
+
+	for(auto y = 0u; y < kept_rows; ++y)
+		materialize(y);
+
+	// the kept rows are re-laid out in place, for the new row stride
+	const auto row = [this](std::size_t y, std::size_t width) { return _buffer.begin() + int(y*width); };
+
+	if(new_width < _width)
+	{
+		// rows move towards the start; the first row first
+		for(auto y = 1u; y < kept_rows; ++y)
+			std::copy(row(y, _width), row(y, _width) + int(new_width), row(y, new_width));
 
-			auto row_iter = _buffer.begin() + int(_height*_width);
-			for (auto y = _height; y < new_height; ++y, std::advance(row_iter, _width))
+		_buffer.resize(num_cells);
+
+		// double width characters cut in half by the right edge
+		for(auto y = 0u; y < kept_rows and new_width > 0; ++y)
+		{
+			auto &last = *(row(y, new_width) + int(new_width) - 1);
+			if(last.width > 1)
 			{
-				for(auto iter = row_iter; iter != row_iter + int(_width); ++iter)
-				{
-					auto &cell = *iter;
-
-					cell.ch[0] = '\0';
-					cell.width = 0;
-					cell.look = Look();
-				};
+				last.ch[0] = ' ';
+				last.ch[1] = '\0';
+				last.width = 1;
 			}
 		}
 	}
+	else
+	{
+		_buffer.resize(num_cells);
+
+		// rows move towards the end; the last row first
+		for(auto y = kept_rows; y-- > 0 and new_width > _width;)
+		{
+			std::copy_backward(row(y, _width), row(y, _width) + int(_width), row(y, new_width) + int(_width));
+			std::fill(row(y, new_width) + int(_width), row(y + 1, new_width), Cell{});
+		}
+	}
 
-	if(not resized)
+	// added rows
+	if(preserve_content)
+	{
+		std::fill(row(kept_rows, new_width), _buffer.end(), Cell{});
+		_row_epochs.resize(new_height, _epoch);
+	}
+	else
 	{
-		// resize to 0 and then to new size, to force all cells to default  (is there a better way?)
-		_buffer.resize(0);
-		_buffer.resize(new_height*new_width);
+		// nothing is kept, i.e. every row is cleared (lazily)
+		_cleared = Cell{};
+		++_epoch;
+		_row_epochs.assign(new_height, _epoch - 1);
 	}
 
+	const auto width_changed = new_width != _width;
+
 	_width = new_width;
 	_height = new_height;
+
+	_cleared_hash = 0;
+	for(auto x = 0u; x < _width; ++x)
+		_cleared_hash ^= cell_hash(_cleared, x);
+
+	// whatever was there before, it's all new now
+	_dirty_rows.resize(_height);
+	mark_dirty();
+
+	// (rows keep their hashes, if the width is the same)
+	_row_hashes.resize(_height);
+	if(width_changed or not preserve_content)
+		_stale_hashes.assign(_height, true);
+	else
+		_stale_hashes.resize(_height, true);
 }
 
 
@@ -2,20 +2,33 @@
 #include <termic/utf8.h>
 #include <termic/text.h>
 #include <termic/terminal.h>
+#include <termic/uring-writer.h>
 
 #include <mk-wcwidth.h>
 
 #include <string_view>
 using namespace std::literals;
 #include <algorithm>
+#include <array>
 #include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <utility>
 #include <fmt/format.h>
 using namespace fmt::literals;
 
 #include <sys/ioctl.h>
+#include <sys/uio.h>
+#include <sys/eventfd.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
 #include <assert.h>
 
 static const std::size_t g_tab_width { 8 };
+static constexpr std::size_t g_max_bands { 8 };  // rows rendered concurrently (on very large screens)
 
 
 namespace termic
@@ -28,41 +41,366 @@ namespace esc
 [[maybe_unused]] static constexpr auto esc { "\x1b"sv };
 [[maybe_unused]] static constexpr auto csi { "\x1b["sv };
 
-[[maybe_unused]] static constexpr auto cuu { "\x1b[{:d}A"sv };
-[[maybe_unused]] static constexpr auto cud { "\x1b[{:d}B"sv };
-[[maybe_unused]] static constexpr auto cuf { "\x1b[{:d}C"sv };
-[[maybe_unused]] static constexpr auto cub { "\x1b[{:d}D"sv };
-[[maybe_unused]] static constexpr auto cup { "\x1b[{1:d};{0:d}H"sv };
-[[maybe_unused]] static constexpr auto ed  { "\x1b[{}J"sv }; // erase lines: 0 = before cursor, 1 = after cursor, 2 = entire screen
-[[maybe_unused]] static constexpr auto el  { "\x1b[{}K"sv }; // erase line:  0 = before cursor, 1 = after cursor, 2 = entire line
-
-[[maybe_unused]] static constexpr auto fg { "\x1b[3{:s}m"sv };
-[[maybe_unused]] static constexpr auto bg { "\x1b[4{:s}m"sv };
-[[maybe_unused]] static constexpr auto fg_bg { "\x1b[3{:s};4{:s}m"sv };
-[[maybe_unused]] static constexpr auto style { "\x1b[{}m"sv };
+// sequences with numeric parameters are written by Output::csi(), these are their final bytes
+[[maybe_unused]] static constexpr auto cuu { 'A' };
+[[maybe_unused]] static constexpr auto cud { 'B' };
+[[maybe_unused]] static constexpr auto cuf { 'C' };
+[[maybe_unused]] static constexpr auto cub { 'D' };
+[[maybe_unused]] static constexpr auto cha { 'G' };  // column (1-based)
+[[maybe_unused]] static constexpr auto vpa { 'd' };  // row (1-based)
+[[maybe_unused]] static constexpr auto cup { 'H' };  // row;column (1-based), without the column: column 1
+[[maybe_unused]] static constexpr auto ed  { 'J' };  // erase lines: 0 = before cursor, 1 = after cursor, 2 = entire screen
+[[maybe_unused]] static constexpr auto el  { 'K' };  // erase line:  0 = before cursor, 1 = after cursor, 2 = entire line
+[[maybe_unused]] static constexpr auto su  { 'S' };  // scroll up (within the scroll region)
+[[maybe_unused]] static constexpr auto sd  { 'T' };  // scroll down (within the scroll region)
+[[maybe_unused]] static constexpr auto decstbm { 'r' };  // set scroll region (top and bottom rows, 1-based)
+[[maybe_unused]] static constexpr auto ech { 'X' };  // erase characters (from the cursor, not moving it)
+[[maybe_unused]] static constexpr auto rep { 'b' };  // repeat the preceding character
+[[maybe_unused]] static constexpr auto ich { '@' };  // insert blank characters (shifting the rest of the line right)
+[[maybe_unused]] static constexpr auto dch { 'P' };  // delete characters (shifting the rest of the line left)
+[[maybe_unused]] static constexpr auto sgr { 'm' };  // select graphic rendition (colors & style)
+
+[[maybe_unused]] static constexpr auto cup_home { "\x1b[H"sv };
+[[maybe_unused]] static constexpr auto newline { "\r\n"sv };
+[[maybe_unused]] static constexpr auto decstbm_reset { "\x1b[r"sv };    // scroll region = whole screen
+[[maybe_unused]] static constexpr auto el_right { "\x1b[K"sv };  // el[0]
+
+// synchronized output markers (if supported, the terminal renders what's between them as one frame)
+[[maybe_unused]] static constexpr auto synch_start { "\x1b[?2026h"sv };
+[[maybe_unused]] static constexpr auto synch_end   { "\x1b[?2026l"sv };
+
+[[maybe_unused]] static constexpr auto rgb_fg { "\x1b[38;2;"sv };  // followed by r;g;b, then sgr
+[[maybe_unused]] static constexpr auto rgb_bg { "\x1b[48;2;"sv };
+[[maybe_unused]] static constexpr auto default_fg { "\x1b[39m"sv };
+[[maybe_unused]] static constexpr auto default_bg { "\x1b[49m"sv };
+[[maybe_unused]] static constexpr auto style_reset { "\x1b[m"sv }; // default colors & style
 [[maybe_unused]] static constexpr auto clear_screen { "\x1b[2J"sv }; // ed[2]
 
 
 } // NS: esc
 
 static std::string safe(std::string_view s);
+static int nonblocking_fd(int fd);
+static std::size_t print_to(ScreenBuffer &buffer, const Rectangle &area, Pos &cursor, Pos pos, std::string_view s, Look lk);
+
+// whether a cell looks the same as an erased cell (with the same background color)
+static inline bool is_blank(const Cell &cell)
+{
+	static constexpr Style visible_styles { style::Underline | style::Overstrike | style::Inverse };
+
+	return (cell.ch[0] == '\0' or (cell.ch[0] == ' ' and cell.ch[1] == '\0'))
+		and (cell.width == 1 or cell.ch[0] == '\0')  // not the right half of a double width character
+		and (cell.look.style & visible_styles) == 0;
+}
+
+// a layer's cell that shows the layers below it
+static inline bool is_transparent(const Cell &cell)
+{
+	return cell.look.bg == color::Transparent and is_blank(cell);
+}
+
+// mark the cells of a layer that aren't transparent as dirty in 'dest'
+static void mark_covered(const ScreenBuffer &layer, ScreenBuffer &dest)
+{
+	const auto &[width, height] = layer.size();
+
+	for(auto y = 0u; y < height; ++y)
+	{
+		auto first { width };
+		auto last { 0ul };
+		for(auto x = 0u; x < width; ++x)
+		{
+			if(not is_transparent(layer.cell({ x, y })))
+			{
+				first = std::min(first, std::size_t(x));
+				last = x;
+			}
+		}
+		if(first < width)
+			dest.mark_dirty(y, first, last);
+	}
+}
+
+// what to write for a single width cell; blank and non-printable cells are written as a space
+static inline std::string_view printable(const Cell &cell)
+{
+	if(cell.ch[0] == '\0' or (cell.ch[1] == '\0' and cell.ch[0] <= 0x20))
+		return " "sv;
+	return cell.ch;
+}
+
+static inline std::size_t num_digits(std::size_t n)
+{
+	auto digits { 1u };
+	for(; n >= 10; n /= 10)
+		++digits;
+	return digits;
+}
+
+static inline std::size_t csi_n_cost(std::size_t n)
+{
+	return 3 + (n == 1? 0: num_digits(n));
+}
+
+namespace
+{
+
+// the cheapest way (in bytes) to move the cursor
+struct Motion
+{
+	enum Kind
+	{
+		None,
+		// horizontal
+		Column,         // CHA
+		Return,         // CR
+		ReturnForward,  // CR + CUF
+		Forward,        // CUF
+		Back,           // CUB
+		Backspace,      // BS (repeated)
+		// vertical
+		Row,            // VPA
+		Up,             // CUU
+		Down,           // CUD
+		NewLine,        // CR LF (repeated), also covers the horizontal movement
+	};
+
+	bool absolute { true };  // CUP
+	Kind horizontal { None };
+	Kind vertical { None };
+	std::size_t cost { 0 };
+};
+
+} // anon NS
+
+static Motion plan_motion(Pos from, Pos to, std::size_t width)
+{
+	Motion motion;
+
+	// CUP, omitting default parameters
+	if(to.x == 0)
+		motion.cost = to.y == 0? 3: 3 + num_digits(to.y + 1);
+	else
+		motion.cost = 4 + num_digits(to.y + 1) + num_digits(to.x + 1);
+
+	if(to.x >= width)
+		return motion;
+
+	// after writing to the last column, the cursor is left in a "pending wrap" state,
+	//   how relative movements behave then differs between terminals, so only absolute column movements are used
+	const bool column_known = from.x < width;
+
+	auto h_cost { 0ul };
+	auto horizontal { Motion::None };
+
+	if(to.x != from.x or not column_known)
+	{
+		const auto consider = [&h_cost, &horizontal](Motion::Kind kind, std::size_t cost) {
+			if(horizontal == Motion::None or cost < h_cost)
+			{
+				horizontal = kind;
+				h_cost = cost;
+			}
+		};
+
+		consider(Motion::Column, csi_n_cost(to.x + 1));
+		if(to.x == 0)
+			consider(Motion::Return, 1);
+		else
+			consider(Motion::ReturnForward, 1 + csi_n_cost(to.x));
+
+		if(column_known)
+		{
+			if(to.x > from.x)
+				consider(Motion::Forward, csi_n_cost(to.x - from.x));
+			else
+			{
+				consider(Motion::Back, csi_n_cost(from.x - to.x));
+				consider(Motion::Backspace, from.x - to.x);
+			}
+		}
+	}
+
+	auto v_cost { 0ul };
+	auto vertical { Motion::None };
+
+	if(to.y != from.y)
+	{
+		vertical = Motion::Row;
+		v_cost = csi_n_cost(to.y + 1);
+
+		const auto relative = to.y > from.y? Motion::Down: Motion::Up;
+		const auto relative_cost = csi_n_cost(to.y > from.y? to.y - from.y: from.y - to.y);
+		if(relative_cost < v_cost)
+		{
+			vertical = relative;
+			v_cost = relative_cost;
+		}
+	}
+
+	if(h_cost + v_cost < motion.cost)
+	{
+		motion.absolute = false;
+		motion.horizontal = horizontal;
+		motion.vertical = vertical;
+		motion.cost = h_cost + v_cost;
+	}
+
+	// down to the start of a line; CR LF (not only LF, since the tty might not translate it)
+	if(to.x == 0 and to.y > from.y and 2*(to.y - from.y) < motion.cost)
+	{
+		motion.absolute = false;
+		motion.horizontal = Motion::None;
+		motion.vertical = Motion::NewLine;
+		motion.cost = 2*(to.y - from.y);
+	}
+
+	return motion;
+}
+
+
+struct Screen::Renderer
+{
+	Renderer() :
+		wake_fd(::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+	{
+	}
+	~Renderer()
+	{
+		if(wake_fd >= 0)
+			::close(wake_fd);
+	}
+
+	std::thread thread;
+
+	std::mutex mutex;
+	std::condition_variable wake;  // 'pending' or 'quit' was set
+	std::condition_variable idle;  // 'busy' was cleared
+	const int wake_fd;             // also signalled, while it waits for the terminal
+
+	inline void notify()
+	{
+		wake.notify_one();
+		const std::uint64_t one { 1 };
+		[[maybe_unused]] auto _ = ::write(wake_fd, &one, sizeof(one));
+	}
+
+	// changes published by update(), not yet rendered (guarded by 'mutex')
+	ScreenBuffer snapshot;
+	bool pending { false };
+	bool busy { false };
+	bool quit { false };
+
+	// what's being rendered; only accessed by the render thread
+	ScreenBuffer buffer;
+
+	// start over from what the terminal shows (nothing dirty)
+	inline void reset(const ScreenBuffer &front)
+	{
+		snapshot.set_size(front.size());
+		snapshot = front;
+		buffer.set_size(front.size());
+		buffer = front;
+		for(auto y = 0u; y < front.size().height; ++y)
+		{
+			snapshot.clear_dirty(y);
+			buffer.clear_dirty(y);
+		}
+		pending = false;
+	}
+};
+
+struct Screen::BandWorkers
+{
+	~BandWorkers()
+	{
+		{
+			std::lock_guard lock(mutex);
+			quit = true;
+		}
+		start.notify_all();
+		for(auto &thread: threads)
+			thread.join();
+	}
+
+	std::vector<std::thread> threads;  // rendering band 1, 2, ...
+
+	std::mutex mutex;
+	std::condition_variable start;  // 'frame' was incremented, or 'quit' was set
+	std::condition_variable done;   // 'remaining' dropped to zero
+	std::size_t frame { 0 };
+	std::size_t remaining { 0 };
+	bool quit { false };
+
+	// the current frame (guarded by 'mutex' while it's being set up)
+	ScreenBuffer *back { nullptr };
+	std::size_t num_bands { 0 };
+	std::size_t band_height { 0 };
+
+	// the results of each band; the outputs are kept between updates, to re-use their buffers
+	std::array<Output, g_max_bands> outputs;
+	std::array<std::size_t, g_max_bands> prelude {};  // size of the output's initial cursor position and attributes
+	std::array<std::size_t, g_max_bands> updated {};
+};
 
 
 Screen::Screen(int fd) :
-	_fd(fd)
+	_fd(fd),
+	_out_fd(nonblocking_fd(fd))
 {
 	// try to preserve front buffer on resize (don't care about back buffer, though)
+	//   (set_size() also moves the cursor to the origin, b/c default cursor position = 0,0)
 	_front_buffer.preserve_content = true;
 
-	_output_buffer.append(fmt::format(esc::cup, 1, 1)); // go to origin (b/c default _cursor.pos = 0,0)
+	set_max_bands(std::size_t(std::thread::hardware_concurrency()));
+}
+
+Screen::~Screen()
+{
+	set_threaded(false);
+	_band_workers.reset();
+	set_io_uring(false);  // (waits for the write in flight)
+
+	if(_out_fd != _fd)
+		::close(_out_fd);
 }
 
-void Screen::invalidate()
+void Screen::invalidate(Rectangle rect)
 {
+	rect = rect.intersection(this->rect());
+	if(rect.empty())
+		return;
+
 	_dirty = true;
+
+	// merge with existing rectangles, as long as that doesn't cover (much) more area
+	for(auto iter = _damage.begin(); iter != _damage.end();)
+	{
+		const auto merged = iter->united(rect);
+		if(merged.area() <= iter->area() + rect.area())
+		{
+			rect = merged;
+			_damage.erase(iter);
+			iter = _damage.begin();  // the grown rectangle might now be mergeable with others
+		}
+		else
+			++iter;
+	}
+
+	static constexpr auto max_damage_rects { 16u };
+
+	if(_damage.size() == max_damage_rects)
+	{
+		// too fragmented, just use the bounding rectangle
+		for(const auto &r: _damage)
+			rect = rect.united(r);
+		_damage.clear();
+	}
+
+	_damage.push_back(rect);
 }
 
-std::size_t Screen::print(Alignment align, Pos anchor_pos, std::string_view s, Look lk)
+std::size_t RegionI::print(Alignment align, Pos anchor_pos, std::string_view s, Look lk)
 {
 	Pos pos { anchor_pos };
 
@@ -86,7 +424,7 @@ std::size_t Screen::print(Alignment align, Pos anchor_pos, std::string_view s, L
 }
 
 
-std::size_t Screen::print(Pos pos, std::size_t wrap_width, std::string_view s, Look lk)
+std::size_t RegionI::print(Pos pos, std::size_t wrap_width, std::string_view s, Look lk)
 {
 	const auto &[width, height] = size();
 
@@ -105,28 +443,97 @@ std::size_t Screen::print(Pos pos, std::size_t wrap_width, std::string_view s, L
 	for(const auto &line: lines)
 	{
 		print(pos, line, lk);
-		pos.y = _client_cursor.y + 1;
+		pos.y = cursor().y + 1;
 		if(pos.y >= height)
 			break;
 	}
 
-	return _client_cursor.y - start_y + 1;
+	return cursor().y - start_y + 1;
+}
+
+std::size_t RegionI::measure(std::string_view s) const
+{
+	std::size_t width { 0 };
+
+	const auto s_end = utf8::end(s);
+	for(auto iter = utf8::begin(s); iter != s_end; ++iter)
+		width += static_cast<std::size_t>(std::max(0, ::mk_width(iter->codepoint)));
+
+	return width;
+}
+
+void RegionI::blit(const Surface &src, Pos pos)
+{
+	blit(src, src.rect(), pos);
 }
 
 std::size_t Screen::print(Pos pos, std::string_view s, Look lk)
 {
-	const auto &[width, height] = size();
+	return print_clipped(rect(), _client_cursor, pos, s, lk);
+}
+
+std::size_t Screen::print_clipped(const Rectangle &area, Pos &cursor, Pos pos, std::string_view s, Look lk)
+{
+	if(pos.y < area.size.height)
+		_dirty = true;
+
+	return print_to(target(), area, cursor, pos, s, lk);
+}
+
+Surface::Surface(Size size)
+{
+	set_size(size);
+}
+
+void Surface::set_size(Size size)
+{
+	_buffer.set_size(size);
+	_buffer.clear();
+}
+
+void Surface::clear(Color bg, Color fg)
+{
+	_buffer.clear(bg, fg);
+}
+
+void Surface::clear(const Rectangle &rect, Color bg, Color fg)
+{
+	_buffer.clear(rect, bg, fg);
+}
+
+std::size_t Surface::print(Pos pos, std::string_view s, Look lk)
+{
+	return print_to(_buffer, rect(), _cursor, pos, s, lk);
+}
+
+void Surface::blit(const Surface &src, Rectangle src_rect, Pos pos)
+{
+	_buffer.blit(src._buffer, src_rect, pos);
+}
+
+void Surface::set_cell(Pos pos, std::string_view ch, std::size_t width, Look lk)
+{
+	_buffer.set_cell(pos, ch, width, lk);
+}
+
+static std::size_t print_to(ScreenBuffer &buffer, const Rectangle &area, Pos &cursor, Pos pos, std::string_view s, Look lk)
+{
+	// 'pos' and 'cursor' are relative to 'area'
+	const auto &[width, height] = area.size;
 
 	if(pos.y >= height)
 	{
 		if(g_log) fmt::print(g_log, "print: off-screen: y  ({})\n", pos.y);
 		return 0;
 	}
-	go_to(pos);
+	cursor = pos;
 
 	auto cx = pos.x;
 
-	_dirty = true;
+	const auto [left, top] = area.top_left;
+
+	// a double width character may not spill over into a neighbouring area
+	const bool at_edge = left + width >= buffer.size().width;
 
 	auto max_width { 0ul };
 	auto curr_width { 0ul };
@@ -142,7 +549,7 @@ std::size_t Screen::print(Pos pos, std::string_view s, Look lk)
 			++pos.y;
 			if(pos.y >= height)
 				break;
-			go_to(pos);
+			cursor = pos;
 			continue;
 		}
 		if(iter->codepoint == '\t')  // jump to next tab stop
@@ -150,7 +557,7 @@ std::size_t Screen::print(Pos pos, std::string_view s, Look lk)
 			const auto tab_skip = ((cx / g_tab_width) + 1) * g_tab_width - cx;
 			curr_width += tab_skip;
 			cx = pos.x + curr_width;
-			go_to(pos);
+			cursor = pos;
 			continue;
 		}
 		if(iter->codepoint == '\v')  // vertical tab (next line w/o carriage return)
@@ -158,7 +565,7 @@ std::size_t Screen::print(Pos pos, std::string_view s, Look lk)
 			++pos.y;
 			if(pos.y >= height)
 				break;
-			go_to({ pos.x, pos.y });
+			cursor = { pos.x, pos.y };
 			continue;
 		}
 
@@ -170,14 +577,16 @@ std::size_t Screen::print(Pos pos, std::string_view s, Look lk)
 
 		const auto chwidth = static_cast<std::size_t>(std::max(0, ::mk_width(iter->codepoint)));
 
+		if(chwidth == 2 and cx == width - 1 and not at_edge)
+			break;
 
-		_back_buffer.set_cell({ cx, pos.y }, iter->sequence, chwidth, lk);
+		buffer.set_cell({ left + cx, top + pos.y }, iter->sequence, chwidth, lk);
 
 		if(chwidth == 2 and cx < width - 1)
 		{
 			static const auto space { " "sv };
 			// set right-neighbour of double width cell to zero width
-			_back_buffer.set_cell({ cx + 1, pos.y }, space, 0, lk);
+			buffer.set_cell({ left + cx + 1, top + pos.y }, space, 0, lk);
 		}
 
 		curr_width += chwidth;
@@ -187,7 +596,7 @@ std::size_t Screen::print(Pos pos, std::string_view s, Look lk)
 //		if(g_log) fmt::print(g_log, "{} width: {} -> cx: {}\n", iter->index, chwidth, cx);
 	}
 
-	_client_cursor.x += curr_width;
+	cursor.x += curr_width;
 
 	max_width = std::max(max_width, curr_width);
 
@@ -196,18 +605,21 @@ std::size_t Screen::print(Pos pos, std::string_view s, Look lk)
 
 void Screen::clear(Color bg, Color fg)
 {
-	_back_buffer.clear(bg, fg);
-	_dirty = true;
+	target().clear(bg, fg);
+	invalidate();
 
-	cursor_move({ 0, 0 });
+	if(not _renderer)  // otherwise, the cursor belongs to the render thread
+		_output.cursor_move({ 0, 0 });
 }
 
 void Screen::clear(const Rectangle &rect, Color bg, Color fg)
 {
-	_back_buffer.clear(rect, bg, fg);
-	_dirty = true;
+	target().clear(rect, bg, fg);
+	// an empty rectangle still clears one cell (see ScreenBuffer::clear)
+	invalidate({ rect.top_left, { std::max(1ul, rect.size.width), std::max(1ul, rect.size.height) } });
 
-	cursor_move({ 0, 0 });
+	if(not _renderer)
+		_output.cursor_move({ 0, 0 });
 }
 
 void Screen::go_to(Pos pos)
@@ -215,236 +627,1547 @@ void Screen::go_to(Pos pos)
 	_client_cursor = pos;
 }
 
-void Screen::set_size(Size size)
+void Screen::blit(const Surface &src, Rectangle src_rect, Pos pos)
 {
-	const auto curr_size = _back_buffer.size();
-
-	_output_buffer.reserve(std::max(150ul, size.width)*std::max(100ul, size.height)*8);  // an over-estimate in an attempt to avoid re-allocation
+	target().blit(src.buffer(), src_rect, pos);
+	_dirty = true;
+}
 
-	_back_buffer.set_size(size);
-	_front_buffer.set_size(size);
+Region Screen::region(Rectangle rect)
+{
+	return Region(*this, rect);
+}
 
-	if(size.width < curr_size.width)
-		_front_buffer.clear(color::Default, color::Default, true);
+Region::Region(Screen &screen, Rectangle bounds) :
+	_screen(screen),
+	_bounds(bounds)
+{
 }
 
-void Screen::update()
+Size Region::size() const
 {
-	if(not _dirty)
-		return;
+	return area().size;
+}
 
-	const auto t0 = std::chrono::high_resolution_clock::now();
+void Region::set_bounds(Rectangle bounds)
+{
+	_bounds = bounds;
+}
 
-	// compare '_back_buffer' and '_front_buffer',
-	//   write the difference to the output buffer (such that '_front_buffer' becomes identical to '_back_buffer')
+Region Region::region(Rectangle rect) const
+{
+	rect = rect.intersection(this->rect());
 
-	const auto size = _back_buffer.size();
+	return Region(_screen, { to_screen(rect.top_left), rect.size });
+}
 
-	const auto start_pos { _cursor.position };
+void Region::invalidate(Rectangle rect)
+{
+	rect = rect.intersection(this->rect());
+	if(rect.empty())
+		return;
 
-	auto num_updated { 0u };
+	_screen.invalidate({ to_screen(rect.top_left), rect.size });
+	drawn();
+}
 
-	for(std::size_t cy = 0; cy < size.height; ++cy)
-	{
-		for(std::size_t cx = 0; cx < size.width;)
-		{
-			auto &back_cell = _back_buffer.cell({ cx, cy });
-			auto &front_cell = _front_buffer.cell({ cx, cy });
+void Region::clear(Color bg, Color fg)
+{
+	clear(rect(), bg, fg);
+}
 
-			if(back_cell != front_cell)
-			{
-				cursor_move({ cx, cy });
-				cursor_set_look(back_cell.look);
+void Region::clear(const Rectangle &rect, Color bg, Color fg)
+{
+	// (unlike the screen's clear(), an empty rectangle clears nothing)
+	const auto clipped = rect.intersection(this->rect());
+	if(clipped.empty())
+		return;
 
-				// if we're at the right edge of the screen and current cell is double width, it's not possible to draw it
-				if((back_cell.ch[1] == '\0' and back_cell.ch[0] <= 0x20) or (cx == size.width - 1 and back_cell.width > 1))  // <= 0x20 should actually be "non-printable"
-				{
-					_output_buffer += ' ';
-					++_cursor.position.x;
-				}
-				else
-				{
-//					_out(fmt::format("{:c}"sv, char(back_cell.ch))); // TODO: one unicode codepoint
-					if(back_cell.ch[0] != '\0')
-						_out(back_cell.ch);
-					else
-						_output_buffer += ' ';
-					_cursor.position.x += back_cell.width;
-				}
+	_screen.clear({ to_screen(clipped.top_left), clipped.size }, bg, fg);
+	drawn();
+}
 
-				++num_updated;
-			}
+void Region::go_to(Pos pos)
+{
+	_cursor = pos;
+}
 
-			cx += back_cell.width? back_cell.width: 1;
-		}
-	}
+std::size_t Region::print(Pos pos, std::string_view s, Look lk)
+{
+	const auto area = this->area();
+	if(area.empty())
+		return 0;
 
-	if(num_updated)
-		cursor_move(start_pos);
+	drawn();
 
-	// should always flush, even if we didn't output anything in this function
-	flush_buffer();
+	return _screen.print_clipped(area, _cursor, pos, s, lk);
+}
 
-	if(num_updated > 0)
-	{
-		// the terminal content is now in synch with back buffer, we can copy back -> front
-		_front_buffer = _back_buffer;
+void Region::blit(const Surface &src, Rectangle src_rect, Pos pos)
+{
+	const auto &[width, height] = size();
+	if(pos.x >= width or pos.y >= height)
+		return;
 
-//		if(g_log) fmt::print(g_log, "updated cells: {}\n", num_updated);
-		const auto t1 = std::chrono::high_resolution_clock::now();
-		if(g_log) fmt::print(g_log, "screen updated, {} µs  ({} cells)\n", std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count(), num_updated);
-	}
+	// clip to the region (the screen clips the rest)
+	src_rect.size = { std::min(src_rect.size.width, width - pos.x), std::min(src_rect.size.height, height - pos.y) };
 
-	_dirty = false;
+	_screen.blit(src, src_rect, to_screen(pos));
+	drawn();
 }
 
-Size Screen::get_terminal_size()
+Cell &Region::cell(Pos pos)
 {
-	return term::get_size(_fd);
+	drawn();
+	return _screen.cell(to_screen(pos));
 }
 
-std::size_t Screen::measure(std::string_view s) const
+const Cell &Region::cell(Pos pos) const
 {
-	std::size_t width { 0 };
+	return std::as_const(_screen).cell(to_screen(pos));
+}
 
-	const auto s_end = utf8::end(s);
-	for(auto iter = utf8::begin(s); iter != s_end; ++iter)
-		width += static_cast<std::size_t>(std::max(0, ::mk_width(iter->codepoint)));
+void Region::set_cell(Pos pos, std::string_view ch, std::size_t width, Look lk)
+{
+	if(pos.x >= size().width or pos.y >= size().height)
+		return;
 
-	return width;
+	drawn();
+	_screen.set_cell(to_screen(pos), ch, width, lk);
 }
 
-Cell Screen::pick(Pos pos) const
+std::unique_lock<std::mutex> Screen::pause_renderer()
 {
-	return cell(pos);
+	std::unique_lock<std::mutex> lock;
+	if(_renderer)
+	{
+		lock = std::unique_lock(_renderer->mutex);
+		_renderer->idle.wait(lock, [this] { return not _renderer->busy; });
+	}
+	return lock;
 }
 
-void Screen::_out(const std::string_view text)
+void Screen::repaint()
 {
-	_output_buffer.append(text);
+	const auto lock = pause_renderer();
+
+	_output.cursor_set_look(Look());
+	_output.out(esc::clear_screen);
+
+	_front_buffer.clear(color::Default, color::Default);
+
+	if(_renderer)
+		_renderer->reset(_front_buffer);
+
+	invalidate();
 }
 
-Pos Screen::cursor_move(Pos pos)
+void Screen::set_size(Size size)
 {
-	const Pos prev_pos { _cursor.position };
+	// e.g. the final resize of a burst, after an intermediate one; nothing to do (and the layers are kept)
+	if(size == this->size())
+		return;
 
-	if(pos.x != _cursor.position.x or pos.y != _cursor.position.y)
-	{
-//		if(g_log) fmt::print(g_log, "cursor: {},{}  ->  {},{}\n", _cursor.position.x, _cursor.position.y, pos.x, pos.y);
-		_cursor.position = pos;
+	// the render thread must not be rendering while the buffers are resized
+	const auto lock = pause_renderer();
+
+	_output.buffer.reserve(std::max(150ul, size.width)*std::max(100ul, size.height)*8);  // an over-estimate in an attempt to avoid re-allocation
 
-		pos.x++; // 1-based
-		pos.y++;
+	// what the terminal still shows is kept (and not written again), only the rest is compared
+	//   (the alternate screen isn't re-wrapped by terminals, the content is just clipped)
+	_back_buffer.set_size(size);
+	_front_buffer.set_size(size);
+	_output.width = size.width;
 
-		if(pos.x != _cursor.position.x and pos.y != _cursor.position.y)
-			_out(fmt::format(esc::cup, pos.x, pos.y));
+	// where the cursor ends up (and whether it's still pending a wrap) varies between terminals
+	_output.out(esc::cup_home);
+	_output.cursor.position = { 0, 0 };
 
-		else if(pos.y == _cursor.position.y)
-		{
-			if(pos.x > _cursor.position.x)
-				_out(fmt::format(esc::cuf, pos.x - _cursor.position.x));
-			else
-				_out(fmt::format(esc::cub, _cursor.position.x - pos.x));
-		}
-		else
-		{
-			if(pos.y > _cursor.position.y)
-				_out(fmt::format(esc::cuu, pos.y - _cursor.position.y));
-			else
-				_out(fmt::format(esc::cud, _cursor.position.y - pos.y));
-		}
+	// like the back buffer, the layers' content doesn't survive a resize
+	if(_layered)
+		_base.set_size(size);
+	for(auto &layer: _layers)
+	{
+		layer.buffer.set_size(size);
+		layer.buffer.clear(color::Transparent, color::Default);
 	}
 
-	return prev_pos;
+	if(_renderer)
+		_renderer->reset(_front_buffer);
+
+	// previous damage might be outside the new size
+	_damage.clear();
+	invalidate();
 }
 
-void Screen::cursor_set_look(Look lk)
+void Screen::update(Budget budget)
 {
-	if(lk.fg != _cursor.look.fg)
+	if(not _dirty)
+		return;
+
+	compose();
+
+	// explicitly invalidated areas are compared, regardless of whether they were written
+	for(const auto &rect: _damage)
 	{
-		_out(fmt::format(esc::fg, escify(lk.fg)));
-		_cursor.look.fg = lk.fg;
+		for(auto y = rect.top_left.y; y <= rect.bottom(); ++y)
+			_back_buffer.mark_dirty(y, rect.top_left.x, rect.right());
 	}
-	if(lk.bg != _cursor.look.bg)
+	_damage.clear();
+
+	if(_renderer)
+		publish();
+	else if(not output_ready())
+	{
+		// the terminal hasn't caught up with the previous update; skip this one.
+		//   the changes remain dirty, so the next update includes them
+		++_frames_dropped;
+		return;
+	}
+	else if(not render(_back_buffer, budget))
+		return;  // the budget ran out, the rest of the changes remain dirty
+
+	_dirty = false;
+	++_updates;
+}
+
+Screen::LayerId Screen::add_layer(bool visible)
+{
+	if(not _layered)
+	{
+		// from now on, the back buffer is composited from the layers
+		_base.set_size(size());
+		_base = _back_buffer;
+		_base.clear_dirty();
+		_layered = true;
+	}
+
+	Layer layer { _next_layer_id++, {}, visible };
+	layer.buffer.set_size(size());
+	layer.buffer.clear(color::Transparent, color::Default);
+	layer.buffer.clear_dirty();  // nothing to show (yet)
+
+	_layers.push_back(std::move(layer));
+
+	return _layers.back().id;
+}
+
+void Screen::remove_layer(LayerId id)
+{
+	const auto found = std::find_if(_layers.begin(), _layers.end(), [id](const auto &layer) { return layer.id == id; });
+	if(found == _layers.end())
+		return;
+
+	// reveal what's below it, including what it covered before its latest changes (not yet composited)
+	if(found->visible)
+		mark_covered(found->buffer, _base);
+	for(auto y = 0u; y < found->buffer.size().height; ++y)
+	{
+		if(found->buffer.is_dirty(y))
+		{
+			const auto span = found->buffer.dirty_span(y);
+			_base.mark_dirty(y, span.first, span.last);
+		}
+	}
+	_dirty = true;
+
+	const auto index = std::size_t(found - _layers.begin()) + 1;
+	if(_target == index)
+		_target = 0;
+	else if(_target > index)
+		--_target;
+
+	_layers.erase(found);
+}
+
+void Screen::show_layer(LayerId id, bool visible)
+{
+	const auto found = std::find_if(_layers.begin(), _layers.end(), [id](const auto &layer) { return layer.id == id; });
+	if(found == _layers.end() or found->visible == visible)
+		return;
+
+	found->visible = visible;
+
+	// what the layer covers needs to be composited again
+	mark_covered(found->buffer, visible? found->buffer: _base);
+	_dirty = true;
+}
+
+void Screen::select_layer(LayerId id)
+{
+	if(id == 0)
+	{
+		_target = 0;
+		return;
+	}
+
+	const auto found = std::find_if(_layers.begin(), _layers.end(), [id](const auto &layer) { return layer.id == id; });
+	if(found == _layers.end())
+	{
+		if(g_log) fmt::print(g_log, "select_layer: no such layer: {}\n", id);
+		return;
+	}
+
+	_target = std::size_t(found - _layers.begin()) + 1;
+}
+
+void Screen::compose()
+{
+	if(not _layered)
+		return;
+
+	const auto &[width, height] = size();
+
+	// only cells that were drawn on (in any layer) need to be composited
+	for(auto y = 0u; y < height; ++y)
+	{
+		auto span = _base.dirty_span(y);
+		_base.clear_dirty(y);
+
+		for(auto &layer: _layers)
+		{
+			const auto layer_span = layer.buffer.dirty_span(y);
+			span.first = std::min(span.first, layer_span.first);
+			span.last = std::max(span.last, layer_span.last);
+			layer.buffer.clear_dirty(y);
+		}
+
+		for(auto x = span.first; x <= span.last and x < width; ++x)
+		{
+			const auto cell = composite({ x, y });
+
+			const auto &back = _back_buffer;  // (the non-const cell() marks it dirty)
+			if(not (back.cell({ x, y }) == cell))
+				_back_buffer.cell({ x, y }) = cell;
+		}
+	}
+
+	if(_layers.empty())
+	{
+		// the back buffer is now identical to the base layer; draw directly on it again
+		_layered = false;
+		_base.set_size({ 0, 0 });
+	}
+}
+
+Cell Screen::composite(Pos pos) const
+{
+	// from the top: the first cell with content, on the first background that isn't transparent
+	const Cell *content { nullptr };
+
+	const auto on_bg = [](Cell cell, Color bg) {
+		cell.look.bg = bg;
+		return cell;
+	};
+
+	for(auto iter = _layers.rbegin(); iter != _layers.rend(); ++iter)
+	{
+		if(not iter->visible)
+			continue;
+
+		const auto &cell = iter->buffer.cell(pos);
+
+		if(cell.look.bg != color::Transparent)
+			return content? on_bg(*content, cell.look.bg): cell;
+
+		if(content == nullptr and not is_transparent(cell))
+			content = &cell;
+	}
+
+	const auto &base = _base.cell(pos);
+	return on_bg(content? *content: base, base.look.bg != color::Transparent? base.look.bg: color::Default);
+}
+
+bool Screen::output_congested() const
+{
+	// output still queued in the tty driver
+	static constexpr auto max_queued_output { 512 };
+
+	int queued { 0 };
+	if(::ioctl(_out_fd, TIOCOUTQ, &queued) == 0 and queued > max_queued_output)
+		return true;
+
+	// some drivers don't report it (e.g. pseudo terminals), but won't be writable when their buffer is full
+	::pollfd pfd { .fd = _out_fd, .events = POLLOUT, .revents = 0 };
+	return ::poll(&pfd, 1, 0) == 0;
+}
+
+bool Screen::output_ready()
+{
+	const bool written = write_unwritten();
+
+	// with io_uring, an update is queued behind the write in flight, and submitted once that completed;
+	//   only one, though (a terminal that doesn't keep up still drops frames)
+	if(_uring and not written)
+		return _unwritten.empty();
+
+	return written and not output_congested();
+}
+
+void Screen::wait_for_terminal(int wake_fd)
+{
+	// until more output can be written, or 'wake_fd' is signalled
+	::pollfd pfds[2] {
+		output_poll(),
+		{ .fd = wake_fd, .events = POLLIN, .revents = 0 },
+	};
+	auto timeout { -1 };
+
+	if(_pending_output == 0)
+	{
+		// congested: either it's not writable (wait until it is), or the tty driver's queue is long,
+		//   which can't be waited for; check it again in a bit
+		static constexpr auto queue_check_interval { 5 };  // ms
+
+		pfds[0] = { .fd = _out_fd, .events = POLLOUT, .revents = 0 };
+		if(::poll(pfds, 1, 0) > 0)
+		{
+			pfds[0].fd = -1;
+			timeout = queue_check_interval;
+		}
+	}
+	if(wake_fd < 0)  // (no event fd) poll instead
+		timeout = timeout < 0? 1: timeout;
+
+	if(::poll(pfds, 2, timeout) > 0 and pfds[1].revents > 0)
+	{
+		std::uint64_t count { 0 };
+		[[maybe_unused]] auto _ = ::read(wake_fd, &count, sizeof(count));
+	}
+}
+
+void Screen::set_max_bands(std::size_t max_bands)
+{
+	// the render thread might be using it
+	const auto lock = pause_renderer();
+
+	_max_bands = std::clamp(max_bands, 1ul, g_max_bands);
+
+	// (re)start the workers, one for each band but the first (that one's rendered by the updating thread)
+	_band_workers.reset();
+	if(_max_bands > 1)
+	{
+		_band_workers = std::make_unique<BandWorkers>();
+		for(auto band = 1ul; band < _max_bands; ++band)
+			_band_workers->threads.emplace_back(&Screen::band_worker, this, band);
+	}
+}
+
+void Screen::set_threaded(bool threaded)
+{
+	if(threaded == bool(_renderer))
+		return;
+
+	if(threaded)
+	{
+		_renderer = std::make_unique<Renderer>();
+		_renderer->reset(_front_buffer);
+
+		_renderer->thread = std::thread([this] {
+			auto &r = *_renderer;
+
+			std::unique_lock lock(r.mutex);
+
+			while(true)
+			{
+				r.wake.wait(lock, [&r] { return r.pending or r.quit; });
+				if(not r.pending)  // i.e. quit, with nothing left to render
+					break;
+
+				// let the terminal catch up first (also with what it didn't accept before);
+				//   more changes might be published meanwhile
+				while(not r.quit and not output_ready())
+				{
+					lock.unlock();
+					wait_for_terminal(r.wake_fd);
+					lock.lock();
+				}
+
+				// take over the published changes
+				for(auto y = 0u; y < r.snapshot.size().height; ++y)
+				{
+					if(r.snapshot.is_dirty(y))
+					{
+						const auto span = r.snapshot.dirty_span(y);
+						r.buffer.copy_span(r.snapshot, y, span);
+						r.buffer.mark_dirty(y, span.first, span.last);
+						r.snapshot.clear_dirty(y);
+					}
+				}
+				r.pending = false;
+				r.busy = true;
+
+				lock.unlock();
+				render(r.buffer, Budget{});
+				lock.lock();
+
+				r.busy = false;
+				r.idle.notify_all();
+			}
+		});
+	}
+	else
+	{
+		// render what's been published, then stop
+		{
+			std::lock_guard lock(_renderer->mutex);
+			_renderer->quit = true;
+		}
+		_renderer->notify();
+		_renderer->thread.join();
+		_renderer.reset();
+	}
+}
+
+void Screen::publish()
+{
+	// copy the changed parts of the back buffer into the snapshot, for the render thread to pick up
+	//   (the snapshot is identical to the back buffer, except its dirty parts)
+	auto &r = *_renderer;
+
+	{
+		std::lock_guard lock(r.mutex);
+
+		for(auto y = 0u; y < _back_buffer.size().height; ++y)
+		{
+			if(_back_buffer.is_dirty(y))
+			{
+				const auto span = _back_buffer.dirty_span(y);
+				r.snapshot.copy_span(_back_buffer, y, span);
+				r.snapshot.mark_dirty(y, span.first, span.last);
+				_back_buffer.clear_dirty(y);
+			}
+		}
+		// the previous changes weren't rendered yet, i.e. that frame is merged with this one
+		if(r.pending)
+			++_frames_dropped;
+		r.pending = true;
+	}
+
+	r.notify();
+}
+
+bool Screen::render(ScreenBuffer &back, Budget budget)
+{
+	const auto t0 = std::chrono::high_resolution_clock::now();
+
+	// compare 'back' and '_front_buffer',
+	//   write the difference to the output buffer (such that '_front_buffer' becomes identical to 'back')
+
+	const auto size = back.size();
+
+	const auto start_pos { _output.cursor.position };
+
+	// if most of the screen became blank, erase all of it first
+	erase_screen(back);
+
+	// let the terminal move rows that only changed position (e.g. a scrolling log)
+	scroll_rows(back);
+
+	// rows that weren't written since the last update can't differ from the front buffer, and
+	//   identical rows (e.g. the same content re-drawn after a clear) needs no further comparison.
+	//   this also calculates all the needed row hashes, before rows are (possibly) compared concurrently
+	auto changed_rows { 0ul };
+	for(std::size_t y = 0; y < size.height; ++y)
+	{
+		if(back.is_dirty(y))
+		{
+			if(back.row_hash(y) == _front_buffer.row_hash(y))
+				back.clear_dirty(y);
+			else
+				++changed_rows;
+		}
+	}
+
+	// on (very) large screens, compare bands of rows concurrently
+	static constexpr auto min_band_cells { 32'000ul };
+
+	const auto num_bands = std::min({
+		_max_bands,
+		std::max(1ul, changed_rows*size.width / min_band_cells),
+	});
+
+	std::size_t num_updated { 0 };
+	bool completed { true };
+
+	if(budget.time.count() > 0 or budget.bytes > 0)
+	{
+		// one row at a time, until the budget is exhausted.
+		//   starting where the previous update stopped, so all rows eventually get updated
+		const auto start_size = _output.buffer.size();
+
+		for(auto row = 0u; row < size.height; ++row)
+		{
+			const auto y = (_resume_row + row) % size.height;
+			num_updated += render_rows(back, y, y + 1, _output);
+
+			const bool exhausted = (budget.time.count() > 0 and std::chrono::high_resolution_clock::now() - t0 >= budget.time)
+				or (budget.bytes > 0 and _output.buffer.size() - start_size >= budget.bytes);
+
+			if(exhausted)
+			{
+				_resume_row = (y + 1) % size.height;
+
+				// there might not actually be anything left
+				for(auto row_y = 0u; row_y < size.height and completed; ++row_y)
+					completed = not back.is_dirty(row_y);
+				break;
+			}
+		}
+	}
+	else if(num_bands > 1)
+		num_updated = render_bands(back, num_bands);
+	else
+		num_updated = render_rows(back, 0, size.height, _output);
+
+	if(num_updated)
+		_output.cursor_move(start_pos);
+
+	// should always flush, even if we didn't output anything in this function
+	flush_buffer();
+
+	if(num_updated > 0)
+	{
+//		if(g_log) fmt::print(g_log, "updated cells: {}\n", num_updated);
+		const auto t1 = std::chrono::high_resolution_clock::now();
+		if(g_log) fmt::print(g_log, "screen updated, {} µs  ({} cells)\n", std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count(), num_updated);
+	}
+
+	return completed;
+}
+
+std::size_t Screen::render_bands(ScreenBuffer &back, std::size_t num_bands)
+{
+	// each band is rendered into its own output, which begins at a known state
+	//   (an absolute cursor position and default attributes), then concatenated in order
+
+	auto &workers = *_band_workers;
+	const auto band_height = (back.size().height + num_bands - 1) / num_bands;
+
+	{
+		std::lock_guard lock(workers.mutex);
+		workers.back = &back;
+		workers.num_bands = num_bands;
+		workers.band_height = band_height;
+		workers.remaining = num_bands - 1;
+		++workers.frame;
+	}
+	workers.start.notify_all();
+
+	render_band(back, 0, band_height);
+
+	{
+		std::unique_lock lock(workers.mutex);
+		workers.done.wait(lock, [&workers] { return workers.remaining == 0; });
+	}
+
+	auto num_updated { 0ul };
+	for(auto band = 0ul; band < num_bands; ++band)
+	{
+		// nothing was written, skip the band completely
+		//   (a band without updated cells might still have shifted some, see shift_cells())
+		const auto &out = workers.outputs[band];
+		if(out.buffer.size() == workers.prelude[band])
+			continue;
+
+		_output.out(out.buffer);
+		_output.cursor = out.cursor;
+		num_updated += workers.updated[band];
+	}
+
+	return num_updated;
+}
+
+void Screen::render_band(ScreenBuffer &back, std::size_t band, std::size_t band_height)
+{
+	auto &workers = *_band_workers;
+	const auto height = back.size().height;
+	const auto first_row = band*band_height;
+	const auto end_row = std::min(height, first_row + band_height);
+
+	auto &out = workers.outputs[band];
+	out.buffer.clear();
+	out.width = _output.width;
+	out.cursor = { { 0, first_row }, Look() };
+	out.csi(first_row + 1, esc::cup);
+	out.out(esc::style_reset);
+	workers.prelude[band] = out.buffer.size();
+
+	workers.updated[band] = render_rows(back, first_row, end_row, out);
+}
+
+void Screen::band_worker(std::size_t band)
+{
+	auto &workers = *_band_workers;
+	std::size_t frame { 0 };  // the last one rendered
+
+	std::unique_lock lock(workers.mutex);
+	while(true)
+	{
+		workers.start.wait(lock, [&] { return workers.quit or workers.frame != frame; });
+		if(workers.quit)
+			break;
+
+		frame = workers.frame;
+		if(band >= workers.num_bands)  // (fewer bands this time)
+			continue;
+
+		lock.unlock();
+		render_band(*workers.back, band, workers.band_height);
+		lock.lock();
+
+		if(--workers.remaining == 0)
+			workers.done.notify_one();
+	}
+}
+
+std::size_t Screen::render_rows(ScreenBuffer &back, std::size_t first_row, std::size_t end_row, Output &out)
+{
+	const auto size = back.size();
+
+	auto num_updated { 0ul };
+
+	const auto &back_buffer = back;
+	const auto &front_buffer = _front_buffer;
+
+	for(auto cy = first_row; cy < end_row; ++cy)
+	{
+		if(not back_buffer.is_dirty(cy))
+			continue;
+
+		auto span = back_buffer.dirty_span(cy);
+
+		// start at the left half if the first dirty cell is covered by a double width character
+		if(span.first > 0 and back_buffer.cell({ span.first - 1, cy }).width > 1)
+			--span.first;
+
+		// if text was inserted or deleted, let the terminal shift the rest of the row
+		if(shift_cells(back, cy, span.first, out))
+		{
+			span.last = size.width - 1;
+			++num_updated;  // (the shift itself; no cell might need drawing after it)
+		}
+
+		for(auto cx = span.first; cx <= span.last and cx < size.width;)
+		{
+			const auto &back_cell = back_buffer.cell({ cx, cy });
+			const auto &front_cell = front_buffer.cell({ cx, cy });
+
+			if(back_cell != front_cell and is_blank(back_cell))
+			{
+				// find the run of blank cells, with the same background color
+				auto run_end { cx + 1 };
+				auto num_changed { 1u };
+				for(; run_end < size.width; ++run_end)
+				{
+					const auto &cell = back_buffer.cell({ run_end, cy });
+					if(not is_blank(cell) or cell.look.bg != back_cell.look.bg)
+						break;
+					num_changed += cell != front_buffer.cell({ run_end, cy });
+				}
+
+				// erase to end of line, or a number of characters (which also needs a cursor move afterwards)
+				static constexpr auto el_cost { 3u };
+				static constexpr auto ech_cost { 10u };
+
+				const bool to_eol = run_end == size.width;
+
+				if(num_changed > (to_eol? el_cost: ech_cost))
+				{
+					out.cursor_move({ cx, cy });
+					out.cursor_set_look(back_cell.look);
+
+					if(to_eol)
+						out.out(esc::el_right);
+					else
+						out.csi(run_end - cx, esc::ech);
+
+					num_updated += num_changed;
+					cx = run_end;
+					continue;
+				}
+			}
+
+			if(back_cell != front_cell)
+			{
+				out.cursor_bridge(back, { cx, cy });
+				out.cursor_set_look(back_cell.look);
+
+				// if we're at the right edge of the screen and current cell is double width, it's not possible to draw it
+				if((back_cell.ch[1] == '\0' and back_cell.ch[0] <= 0x20) or (cx == size.width - 1 and back_cell.width > 1))  // <= 0x20 should actually be "non-printable"
+				{
+					out.buffer += ' ';
+					++out.cursor.position.x;
+				}
+				else
+				{
+//					out.out(fmt::format("{:c}"sv, char(back_cell.ch))); // TODO: one unicode codepoint
+					if(back_cell.ch[0] != '\0')
+						out.out(back_cell.ch);
+					else
+						out.buffer += ' ';
+					out.cursor.position.x += back_cell.width;
+
+					if(capabilities.repeat_char and back_cell.width == 1)
+					{
+						// let the terminal repeat the same character (e.g. a horizontal line)
+						//   (only within the span; what's after it is already shown by the terminal)
+						auto repeats { 0u };
+						while(cx + 1 + repeats <= span.last and cx + 1 + repeats < size.width and back_buffer.cell({ cx + 1 + repeats, cy }) == back_cell)
+							++repeats;
+
+						static constexpr auto rep_cost { 5ul };
+
+						if(repeats*std::strlen(back_cell.ch) > rep_cost)
+						{
+							out.csi(repeats, esc::rep);
+							out.cursor.position.x += repeats;
+							num_updated += repeats;
+							cx += repeats;
+						}
+					}
+				}
+
+				++num_updated;
+			}
+
+			cx += back_cell.width? back_cell.width: 1;
+		}
+
+		// the terminal's row is now in synch with the back buffer, copy the changed part back -> front
+		//   (a double width character at the end of the span covers the next cell too)
+		if(span.last + 1 < size.width and back_buffer.cell({ span.last, cy }).width > 1)
+			++span.last;
+		_front_buffer.copy_span(back_buffer, cy, span);
+
+		back.clear_dirty(cy);
+	}
+
+	return num_updated;
+}
+
+void Screen::erase_screen(ScreenBuffer &back)
+{
+	const auto &[width, height] = back.size();
+
+	const auto &back_buffer = back;
+	const auto &front_buffer = _front_buffer;
+
+	// only worth considering if most rows changed
+	auto changed_rows { 0ul };
+	for(std::size_t y = 0; y < height; ++y)
+		changed_rows += back_buffer.is_dirty(y) and back_buffer.row_hash(y) != front_buffer.row_hash(y);
+
+	if(height == 0 or changed_rows < height/2)
+		return;
+
+	// erasing the screen uses the background color of the top-left cell
+	const auto &origin = back_buffer.cell({ 0, 0 });
+	if(not is_blank(origin))
+		return;
+
+	const auto bg = origin.look.bg;
+	const auto erased = [bg](const Cell &cell) { return is_blank(cell) and cell.look.bg == bg; };
+
+	// approx. bytes needed to erase the row's cells that became blank (w/o erasing the screen)
+	//   vs. cells that are correct now, but would need to be re-drawn after erasing the screen
+	auto keep_cost { 0ul };
+	auto redraw_cost { 0ul };
+
+	static constexpr auto erase_row_cost { 10ul };
+
+	for(std::size_t y = 0; y < height; ++y)
+	{
+		auto row_erased { 0ul };
+
+		for(std::size_t x = 0; x < width; ++x)
+		{
+			const auto &back_cell = back_buffer.cell({ x, y });
+			const auto &front_cell = front_buffer.cell({ x, y });
+
+			if(erased(back_cell))
+				row_erased += not erased(front_cell);
+			else
+				redraw_cost += back_cell == front_cell;
+		}
+
+		keep_cost += std::min(row_erased, erase_row_cost);
+	}
+
+	if(esc::clear_screen.size() + redraw_cost >= keep_cost)
+		return;
+
+	_output.cursor_set_look(origin.look);
+	_output.out(esc::clear_screen);
+
+	_front_buffer.clear(bg, color::Default);
+
+	// everything needs to be compared again
+	back.mark_dirty();
+}
+
+void Screen::scroll_rows(ScreenBuffer &back)
+{
+	// find runs of changed rows whose content exists in the front buffer, but at another row,
+	//   scroll those into place using the terminal's scroll region
+
+	const auto &[width, height] = back.size();
+
+	const auto &back_buffer = back;
+	const auto &front_buffer = _front_buffer;
+
+	const auto changed = [&](std::size_t y) {
+		return back_buffer.is_dirty(y) and back_buffer.row_hash(y) != front_buffer.row_hash(y);
+	};
+
+	static constexpr auto max_scrolls { 4 };
+	static constexpr auto scroll_cost { 20ul };  // approx. bytes of the escape sequences needed
+
+	for(auto count = 0; count < max_scrolls; ++count)
+	{
+		std::size_t best_top { 0 };
+		std::size_t best_len { 0 };
+		long best_shift { 0 };
+		long best_gain { 0 };
+
+		for(std::size_t y = 0; y < height; ++y)
+		{
+			if(not changed(y))
+				continue;
+
+			const auto hash = back_buffer.row_hash(y);
+
+			// nearest front buffer row with the same content
+			long shift { 0 };
+			for(std::size_t dist = 1; dist < height and shift == 0; ++dist)
+			{
+				if(y + dist < height and front_buffer.row_hash(y + dist) == hash)
+					shift = long(dist);
+				else if(dist <= y and front_buffer.row_hash(y - dist) == hash)
+					shift = -long(dist);
+			}
+			if(shift == 0)
+				continue;
+
+			// extend the run as long as the rows keep matching with the same shift
+			std::size_t len { 1 };
+			while(y + len < height and long(y + len) + shift < long(height)
+				  and back_buffer.row_hash(y + len) == front_buffer.row_hash(std::size_t(long(y + len) + shift)))
+				++len;
+
+			// the scroll region covers the run and the rows scrolled in (those must be re-drawn)
+			const auto top = shift > 0? y: std::size_t(long(y) + shift);
+			const auto bottom = shift > 0? std::size_t(long(y + len - 1) + shift): y + len - 1;
+
+			// only the run's rows will be correct after scrolling, the rest of the region will not
+			long matched_before { 0 };
+			for(auto ry = top; ry <= bottom; ++ry)
+				matched_before += back_buffer.row_hash(ry) == front_buffer.row_hash(ry);
+
+			const auto gain = long(len) - matched_before;
+			if(gain > best_gain)
+			{
+				best_top = y;
+				best_len = len;
+				best_shift = shift;
+				best_gain = gain;
+			}
+
+			y += len - 1;
+		}
+
+		if(best_gain <= 0 or std::size_t(best_gain)*width <= scroll_cost)
+			break;
+
+		const auto top = best_shift > 0? best_top: std::size_t(long(best_top) + best_shift);
+		const auto bottom = best_shift > 0? std::size_t(long(best_top + best_len - 1) + best_shift): best_top + best_len - 1;
+
+		// rows scrolled in are blank, using the current background color
+		_output.cursor_set_look(Look{});
+
+		_output.csi(top + 1, bottom + 1, esc::decstbm);
+		if(best_shift > 0)
+			_output.csi(std::size_t(best_shift), esc::su);
+		else
+			_output.csi(std::size_t(-best_shift), esc::sd);
+		_output.out(esc::decstbm_reset);
+
+		// setting the scroll region also moves the cursor to the origin
+		_output.cursor.position = { 0, 0 };
+
+		_front_buffer.scroll(top, bottom, int(best_shift));
+
+		// the front buffer rows changed, so they need to be compared again
+		for(auto y = top; y <= bottom; ++y)
+			back.mark_dirty(y, 0, width - 1);
+	}
+}
+
+bool Screen::shift_cells(const ScreenBuffer &back_buffer, std::size_t y, std::size_t from, Output &out)
+{
+	// find cells that exist in the front buffer's row, but shifted horizontally,
+	//   and shift them into place using insert/delete character
+
+	const auto width = back_buffer.size().width;
+
+	const auto &front_buffer = _front_buffer;
+
+	const auto back = [&](std::size_t x) -> const Cell & { return back_buffer.cell({ x, y }); };
+	const auto front = [&](std::size_t x) -> const Cell & { return front_buffer.cell({ x, y }); };
+
+	static constexpr auto max_shift { 32ul };
+	static constexpr auto min_run { 8ul };  // shifted (non-blank) cells needed to be worth the escape sequence
+	static constexpr auto max_edits { 3 };
+
+	bool shifted { false };
+	bool checked_wide { false };
+
+	for(auto edit = 0; edit < max_edits; ++edit)
+	{
+		// first differing cell
+		while(from < width and back(from) == front(from))
+			++from;
+		if(from + min_run >= width)
+			break;
+
+		std::size_t best_run { 0 };
+		std::size_t best_content { 0 };  // non-blank cells in the run; shifting blanks gains nothing
+		int best_shift { 0 };
+
+		for(auto n = 1ul; n <= max_shift and from + n + min_run < width; ++n)
+		{
+			// inserted: back[from + n ...] == front[from ...]
+			if(back(from + n) == front(from))
+			{
+				auto run { 1ul };
+				std::size_t content = not is_blank(front(from));
+				for(; from + n + run < width and back(from + n + run) == front(from + run); ++run)
+					content += not is_blank(front(from + run));
+				if(content > best_content)
+				{
+					best_run = run;
+					best_content = content;
+					best_shift = int(n);
+				}
+			}
+			// deleted: back[from ...] == front[from + n ...]
+			if(back(from) == front(from + n))
+			{
+				auto run { 1ul };
+				std::size_t content = not is_blank(back(from));
+				for(; from + n + run < width and back(from + run) == front(from + n + run); ++run)
+					content += not is_blank(back(from + run));
+				if(content > best_content)
+				{
+					best_run = run;
+					best_content = content;
+					best_shift = -int(n);
+				}
+			}
+		}
+
+		if(best_content < min_run)
+			break;
+
+		if(not checked_wide)
+		{
+			// shifting double width characters (or parts of them) isn't worth the trouble
+			const auto is_wide = [](const Cell &cell) { return cell.width > 1 or (cell.width == 0 and cell.ch[0] != '\0'); };
+			for(auto x = from; x < width; ++x)
+			{
+				if(is_wide(back(x)) or is_wide(front(x)))
+					return shifted;
+			}
+			checked_wide = true;
+		}
+
+		out.cursor_move({ from, y });
+		// shifted in cells are blank, using the current background color
+		out.cursor_set_look(Look{});
+
+		if(best_shift > 0)
+			out.csi(std::size_t(best_shift), esc::ich);
+		else
+			out.csi(std::size_t(-best_shift), esc::dch);
+
+		_front_buffer.shift_cells(y, from, best_shift);
+		shifted = true;
+
+		// continue after the shifted run
+		from += best_run + std::size_t(std::max(0, best_shift));
+	}
+
+	return shifted;
+}
+
+Size Screen::get_terminal_size()
+{
+	return term::get_size(_fd);
+}
+
+Cell Screen::pick(Pos pos) const
+{
+	if(_layered)
+		return composite(pos);
+
+	return cell(pos);
+}
+
+Pos Screen::Output::cursor_move(Pos pos)
+{
+	const Pos prev_pos { cursor.position };
+
+	if(pos.x != cursor.position.x or pos.y != cursor.position.y)
+	{
+//		if(g_log) fmt::print(g_log, "cursor: {},{}  ->  {},{}\n", cursor.position.x, cursor.position.y, pos.x, pos.y);
+		const auto motion = plan_motion(cursor.position, pos, width);
+
+		const auto from = cursor.position;
+		cursor.position = pos;
+
+		if(motion.absolute)
+		{
+			if(pos.x == 0)
+			{
+				if(pos.y == 0)
+					out(esc::cup_home);
+				else
+					csi(pos.y + 1, esc::cup);
+			}
+			else
+				csi(pos.y + 1, pos.x + 1, esc::cup);
+			return prev_pos;
+		}
+
+		// horizontal first; it resets a "pending wrap" state (see plan_motion())
+		switch(motion.horizontal)
+		{
+		case Motion::None: break;
+		case Motion::Column:        csi_n(pos.x + 1, esc::cha); break;
+		case Motion::Return:        out('\r'); break;
+		case Motion::ReturnForward: out('\r'); csi_n(pos.x, esc::cuf); break;
+		case Motion::Forward:       csi_n(pos.x - from.x, esc::cuf); break;
+		case Motion::Back:          csi_n(from.x - pos.x, esc::cub); break;
+		case Motion::Backspace:     buffer.append(from.x - pos.x, '\b'); break;
+		default: break;
+		}
+
+		switch(motion.vertical)
+		{
+		case Motion::None: break;
+		case Motion::Row:      csi_n(pos.y + 1, esc::vpa); break;
+		case Motion::Up:       csi_n(from.y - pos.y, esc::cuu); break;
+		case Motion::Down:     csi_n(pos.y - from.y, esc::cud); break;
+		case Motion::NewLine:
+			for(auto y = from.y; y < pos.y; ++y)
+				out(esc::newline);
+			break;
+		default: break;
+		}
+	}
+
+	return prev_pos;
+}
+
+std::size_t Screen::Output::cursor_move_cost(Pos pos) const
+{
+	if(pos.x == cursor.position.x and pos.y == cursor.position.y)
+		return 0;
+
+	return plan_motion(cursor.position, pos, width).cost;
+}
+
+void Screen::Output::cursor_bridge(const ScreenBuffer &back_buffer, Pos pos)
+{
+	// if the cursor is a short distance to the left, on the same row,
+	//   re-writing the (unchanged) cells in between might be shorter than moving the cursor.
+	//   the back buffer is used since the terminal is already in synch with it, up to 'pos'.
+	static constexpr auto max_gap { 8u };
+
+	const auto from = cursor.position;
+
+	if(from.y == pos.y and from.x < pos.x and pos.x - from.x <= max_gap)
+	{
+		auto bridge_cost { 0ul };
+		for(auto x = from.x; x < pos.x and bridge_cost != std::string::npos; ++x)
+		{
+			const auto &cell = back_buffer.cell({ x, pos.y });
+			// only single width cells, drawn with the current attributes
+			if(cell.width != 1 or cell.look != cursor.look)
+				bridge_cost = std::string::npos;
+			else
+				bridge_cost += printable(cell).size();
+		}
+
+		if(bridge_cost <= cursor_move_cost(pos))
+		{
+			for(auto x = from.x; x < pos.x; ++x)
+				out(printable(back_buffer.cell({ x, pos.y })));
+			cursor.position.x = pos.x;
+			return;
+		}
+	}
+
+	cursor_move(pos);
+}
+
+void Screen::Output::csi(std::size_t n, char command)
+{
+	out(esc::csi);
+	number(n);
+	out(command);
+}
+
+void Screen::Output::csi(std::size_t n1, std::size_t n2, char command)
+{
+	out(esc::csi);
+	number(n1);
+	out(';');
+	number(n2);
+	out(command);
+}
+
+void Screen::Output::csi_n(std::size_t n, char command)
+{
+	out(esc::csi);
+	if(n != 1)
+		number(n);
+	out(command);
+}
+
+void Screen::Output::number(std::size_t n)
+{
+	char digits[20];
+	auto *first = std::end(digits);
+	do
+	{
+		*--first = char('0' + n % 10);
+		n /= 10;
+	}
+	while(n > 0);
+
+	buffer.append(first, std::size_t(std::end(digits) - first));
+}
+
+void Screen::Output::color(Color c, bool background)
+{
+	if(c == color::Default or c == color::Transparent)
+	{
+		out(background? esc::default_bg: esc::default_fg);
+		return;
+	}
+
+	// TODO: generate 256 or "classic" colors if 24-bit isn't supported
+	out(background? esc::rgb_bg: esc::rgb_fg);
+	number(color::red(c));
+	out(';');
+	number(color::green(c));
+	out(';');
+	number(color::blue(c));
+	out(esc::sgr);
+}
+
+void Screen::Output::cursor_set_look(Look lk)
+{
+	if(lk.fg != cursor.look.fg)
+	{
+		color(lk.fg, false);
+		cursor.look.fg = lk.fg;
+	}
+	if(lk.bg != cursor.look.bg)
 	{
-		_out(fmt::format(esc::bg, escify(lk.bg)));
-		_cursor.look.bg = lk.bg;
+		color(lk.bg, true);
+		cursor.look.bg = lk.bg;
 	}
 
-	if(lk.style != _cursor.look.style)
+	if(lk.style != cursor.look.style)
 	{
-		auto curr = [this]  (auto sb) -> bool { return (_cursor.look.style & sb) > 0; };
+		auto curr = [this]  (auto sb) -> bool { return (cursor.look.style & sb) > 0; };
 		auto to =   [&lk](auto sb) -> bool { return (lk.style         & sb) > 0; };
 
-		// TODO: avoid heap allocation
-		std::string seq;
-		seq.reserve(13);
+		// the parameters are collected on the stack, at most "22;23;24;29;27"
+		char seq[16];
+		std::size_t len { 0 };
+		const auto add = [&seq, &len](std::string_view param) {
+			if(len > 0 and seq[len - 1] != ';')
+				seq[len++] = ';';
+			for(const auto c: param)
+				seq[len++] = c;
+		};
 
 		if(to(style::Bold) and not curr(style::Bold))
-			seq += '1';     // set bold
+			add("1"sv);     // set bold
 		else if(to(style::Dim) and not curr(style::Dim))
-			seq += '2';     // set dim
+			add("2"sv);     // set dim
 		else if(not to(style::Bold) and not to(style::Dim) and (curr(style::Bold) or curr(style::Dim)))
-			seq += "22"sv;  // clear intensity bit
-		if(not seq.empty() and seq[seq.size() - 1] != ';')
-			seq += ';';
+			add("22"sv);    // clear intensity bit
 
 		if(to(style::Italic) and not curr(style::Italic))
-			seq += '3';     // set italic
+			add("3"sv);     // set italic
 		if(not to(style::Italic) and curr(style::Italic))
-			seq += "23"sv;  // clear italic
-		if(not seq.empty() and seq[seq.size() - 1] != ';')
-			seq += ';';
+			add("23"sv);    // clear italic
 
 		if(to(style::Underline) and not curr(style::Underline))
-			seq += '4';     // set underline
+			add("4"sv);     // set underline
 		if(not to(style::Underline) and curr(style::Underline))
-			seq += "24"sv;  // clear underline
-		if(not seq.empty() and seq[seq.size() - 1] != ';')
-			seq += ';';
+			add("24"sv);    // clear underline
 
 		if(to(style::Overstrike) and not curr(style::Overstrike))
-			seq += '9';     // set overstrike
+			add("9"sv);     // set overstrike
 		if(not to(style::Overstrike) and curr(style::Overstrike))
-			seq += "29"sv;  // clear overstrike
+			add("29"sv);    // clear overstrike
 
 		if(to(style::Inverse) and not curr(style::Inverse))
-			seq += '7';     // set inverse
+			add("7"sv);     // set inverse
 		if(not to(style::Inverse) and curr(style::Inverse))
-			seq += "27"sv;  // clear inverse
-
-		// remove final trailing semicolon
-		if(not seq.empty() and seq[seq.size() - 1] == ';')
-			seq.resize(seq.size() - 1);
+			add("27"sv);    // clear inverse
 
-		_out(fmt::format(esc::style, seq));
+		out(esc::csi);
+		out(std::string_view(seq, len));
+		out(esc::sgr);
 
-		_cursor.look.style = lk.style;
+		cursor.look.style = lk.style;
 	}
 }
 
 Cell &Screen::cell(Pos pos)
 {
-	return _back_buffer.cell({ pos.x, pos.y });
+	return target().cell({ pos.x, pos.y });
 }
 
 const Cell &Screen::cell(Pos pos) const
 {
-	return _back_buffer.cell({ pos.x, pos.y });
+	return target().cell({ pos.x, pos.y });
 }
 
 void Screen::set_cell(Pos pos, std::string_view ch, std::size_t width, Look lk)
 {
-	_back_buffer.set_cell(pos, ch, width, lk);
+	target().set_cell(pos, ch, width, lk);
+}
+
+void Screen::flush_buffer(bool pending_only)
+{
+	if(_uring)
+	{
+		submit_output(pending_only);
+		return;
+	}
+
+	// what the terminal didn't accept before goes first
+	::iovec parts[4];
+	auto num_parts { 0 };
+	const auto add = [&parts, &num_parts](std::string_view s) {
+		parts[num_parts++] = { const_cast<char *>(s.data()), s.size() };
+	};
+
+	const bool resumed = not _unwritten.empty();
+	if(resumed)
+		add(_unwritten);
+
+	if(not _output.buffer.empty() and not pending_only)
+	{
+		// bracket the output in synchronized output markers, without copying it
+		if(capabilities.synchronized_output)
+			add(esc::synch_start);
+		add(_output.buffer);
+		if(capabilities.synchronized_output)
+			add(esc::synch_end);
+	}
+
+	if(num_parts == 0)
+		return;
+
+	// write as much as the terminal accepts, without blocking
+	auto first_part { 0 };
+	std::size_t written { 0 };  // of 'first_part', not yet skipped
+	bool failed { false };
+
+	while(first_part < num_parts)
+	{
+		parts[first_part].iov_base = static_cast<char *>(parts[first_part].iov_base) + written;
+		parts[first_part].iov_len -= written;
+		written = 0;
+
+		const auto rc = ::writev(_out_fd, parts + first_part, num_parts - first_part);
+		if(rc == -1 and errno == EINTR)
+			continue;
+		if(rc <= 0)
+		{
+			// EAGAIN: the terminal is busy, the rest is written when it's writable again.
+			//   otherwise it's gone (or broken); keeping the output around won't help
+			failed = rc == -1 and errno != EAGAIN and errno != EWOULDBLOCK;
+			break;
+		}
+
+		// find where the write stopped
+		written = std::size_t(rc);
+		while(first_part < num_parts and written >= parts[first_part].iov_len)
+			written -= parts[first_part++].iov_len;
+	}
+
+	// keep what wasn't written
+	//   (the first part might be '_unwritten' itself, it's only moved within itself)
+	auto keep_part { first_part };
+	if(not failed and resumed and first_part == 0)
+	{
+		_unwritten.erase(0, std::size_t(static_cast<char *>(parts[0].iov_base) - _unwritten.data()));
+		keep_part = 1;
+	}
+	else
+		_unwritten.clear();
+
+	if(not failed)
+	{
+		for(; keep_part < num_parts; ++keep_part)
+			_unwritten.append(static_cast<const char *>(parts[keep_part].iov_base), parts[keep_part].iov_len);
+	}
+	_pending_output = _unwritten.size();
+
+	if(not pending_only)
+		_output.buffer.clear();
+}
+
+bool Screen::write_unwritten()
+{
+	// (the output buffer is left alone; it goes out with the next update)
+	flush_buffer(true);
+	return _pending_output == 0;
+}
+
+bool Screen::write_pending()
+{
+	const auto lock = pause_renderer();
+
+	return write_unwritten();
+}
+
+bool Screen::drain_output(std::chrono::milliseconds timeout)
+{
+	const auto lock = pause_renderer();
+
+	return wait_output(timeout);
+}
+
+bool Screen::wait_output(std::chrono::milliseconds timeout)
+{
+	const auto until = std::chrono::steady_clock::now() + timeout;
+
+	while(not write_unwritten())
+	{
+		const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(until - std::chrono::steady_clock::now());
+		if(remaining <= 0ms)
+			return false;
+
+		auto pfd = output_poll();
+		if(::poll(&pfd, 1, int(remaining.count())) == -1 and errno != EINTR)
+			return false;
+	}
+
+	return true;
+}
+
+::pollfd Screen::output_poll() const
+{
+	// the ring is readable when the write in flight completed
+	if(_uring)
+		return { .fd = _uring->fd(), .events = POLLIN, .revents = 0 };
+
+	return { .fd = _out_fd, .events = POLLOUT, .revents = 0 };
+}
+
+bool Screen::set_io_uring(bool enabled)
+{
+	const auto lock = pause_renderer();
+
+	if(enabled == bool(_uring))
+		return enabled;
+
+	if(enabled)
+	{
+		// the caller's fd is used; io_uring doesn't block the submitter anyway,
+		//   but would fail writes to a non-blocking fd (instead of waiting until it's writable)
+		auto uring = std::make_unique<UringWriter>(_fd);
+		if(*uring)
+		{
+			flush_buffer();  // what's pending is written first
+			_uring = std::move(uring);
+		}
+	}
+	else
+	{
+		// the memory of the write in flight must stay valid until it completed
+		wait_output(1s);
+		if(_uring->busy())
+			return true;
+
+		_uring.reset();
+		_in_flight.clear();
+	}
+
+	return bool(_uring);
+}
+
+void Screen::submit_output(bool pending_only)
+{
+	// one write is in flight at a time (which keeps the order); meanwhile, the output is queued
+	const bool busy = _uring->busy();  // (collects its completion)
+	const bool output = not pending_only and not _output.buffer.empty();
+
+	if(output and (busy or not _unwritten.empty()))
+	{
+		if(capabilities.synchronized_output)
+			_unwritten.append(esc::synch_start);
+		_unwritten.append(_output.buffer);
+		if(capabilities.synchronized_output)
+			_unwritten.append(esc::synch_end);
+		_output.buffer.clear();
+	}
+
+	if(not busy)
+	{
+		// the buffers are swapped (not copied), so their memory is reused
+		if(not _unwritten.empty())
+		{
+			std::swap(_in_flight, _unwritten);
+			_unwritten.clear();
+
+			const ::iovec part { _in_flight.data(), _in_flight.size() };
+			_uring->submit(&part, 1);
+		}
+		else if(output)
+		{
+			std::swap(_in_flight, _output.buffer);
+			_output.buffer.clear();
+
+			::iovec parts[3];
+			auto num_parts { 0u };
+			if(capabilities.synchronized_output)
+				parts[num_parts++] = { const_cast<char *>(esc::synch_start.data()), esc::synch_start.size() };
+			parts[num_parts++] = { _in_flight.data(), _in_flight.size() };
+			if(capabilities.synchronized_output)
+				parts[num_parts++] = { const_cast<char *>(esc::synch_end.data()), esc::synch_end.size() };
+			_uring->submit(parts, num_parts);
+		}
+	}
+
+	_pending_output = _uring->remaining() + _unwritten.size();
 }
 
-void Screen::flush_buffer()
+static int nonblocking_fd(int fd)
 {
-	if(not _output_buffer.empty())
+	// a separate file description for the same terminal, so it can be non-blocking
+	//   (setting O_NONBLOCK on 'fd' would also affect e.g. stdin, and the shell, when they share it)
+	if(::isatty(fd) == 1)
 	{
-		[[maybe_unused]] auto rc = ::write(_fd, _output_buffer.c_str(), _output_buffer.size());
-		_output_buffer.clear();
+		if(const auto *name = ::ttyname(fd); name != nullptr)
+		{
+			if(const auto out_fd = ::open(name, O_WRONLY | O_NOCTTY | O_NONBLOCK | O_CLOEXEC); out_fd != -1)
+				return out_fd;
+		}
 	}
+
+	// writes might block then, but partial writes are still handled
+	return fd;
 }
 
 [[maybe_unused]] static std::string safe(std::string_view s)
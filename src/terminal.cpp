@@ -8,10 +8,12 @@
 #include <cuchar>
 #include <string_view>
 #include <thread>
+#include <utility>
 
 #include <unistd.h>
 #include <termios.h>
 #include <sys/ioctl.h>
+#include <poll.h>
 
 using namespace std::literals;
 
@@ -49,9 +51,13 @@ namespace esc
 [[maybe_unused]] const auto focus_on  { "\x1b[?1004h"sv };
 [[maybe_unused]] const auto focus_off { "\x1b[?1004l"sv };
 
-// terminal synchronized output markers
-[[maybe_unused]] const auto synch_start { "\x1b[?2026h"sv };
-[[maybe_unused]] const auto synch_end   { "\x1b[?2026l"sv };
+// query whether synchronized output (used by Screen) is supported, response: CSI ? 2026 ; <status> $ y
+[[maybe_unused]] const auto synch_query { "\x1b[?2026$p"sv };
+
+// primary device attributes, response: CSI ? ... c
+[[maybe_unused]] const auto device_attributes { "\x1b[c"sv };
+// cursor position report, response: CSI row ; column R
+[[maybe_unused]] const auto cursor_position { "\x1b[6n"sv };
 
 } // NS: esc
 
@@ -71,6 +77,12 @@ using IOFlag = decltype(termios::c_lflag);
 bool modify_io_flags(int fd, bool set, IOFlag flags);
 bool clear_in_flags(int fd, IOFlag flags);
 
+static std::string query(int in_fd, int out_fd, std::string_view request);
+static void detect_capabilities(int in_fd, int out_fd);
+
+static Capabilities s_capabilities;
+static std::string s_early_input;  // read while detecting the capabilities, but not a reply
+
 namespace term
 {
 
@@ -128,6 +140,9 @@ bool init(int in_fd, int out_fd, Options opts)
 		write(esc::focus_on);
 	}
 
+	if(g_log) fmt::print(g_log, "   \x1b[2mterm >> detecting capabilities...\x1b[m\n");
+	detect_capabilities(in_fd, out_fd);
+
 	return true;
 }
 
@@ -188,6 +203,157 @@ Size get_size(int fd)
 	return { std::size_t(size.ws_col), std::size_t(size.ws_row) };
 }
 
+const Capabilities &capabilities()
+{
+	return s_capabilities;
+}
+
+std::string take_early_input()
+{
+	return std::exchange(s_early_input, {});
+}
+
+} // NS: term
+
+static void detect_capabilities(int in_fd, int out_fd)
+{
+	// REP: print a character, repeat it 3 times, and see where the cursor ended up
+	std::string request { "\rx\x1b[3b"sv };
+	request += esc::cursor_position;
+	// synchronized output: query the mode's status (not responding means not supported)
+	request += esc::synch_query;
+
+	s_early_input.clear();
+	s_capabilities = term::parse_capabilities(query(in_fd, out_fd, request), s_early_input);
+
+	// erase the test output
+	::write(out_fd, "\r\x1b[K", 4);
+
+	if(g_log) fmt::print(g_log, "   \x1b[2mterm >> capabilities: repeat char: {}  synchronized output: {}\x1b[m\n", s_capabilities.repeat_char, s_capabilities.synchronized_output);
+}
+
+// the next complete reply (CSI <params> <final byte>) at or after 'pos', without the CSI; empty if there's none.
+//   'pos' is moved past it
+static std::string_view next_reply(std::string_view response, std::size_t &pos)
+{
+	const auto start = response.find("\x1b["sv, pos);
+	if(start == std::string_view::npos)
+	{
+		pos = response.size();
+		return {};
+	}
+
+	// parameters and intermediate bytes are in 0x20 - 0x3f, the final byte in 0x40 - 0x7e
+	auto end = start + 2;
+	while(end < response.size() and (response[end] < 0x40 or response[end] > 0x7e))
+		++end;
+	if(end == response.size())
+	{
+		pos = response.size();
+		return {};
+	}
+
+	pos = end + 1;
+	return response.substr(start + 2, end - start - 1);
+}
+
+static bool is_device_attributes(std::string_view reply)
+{
+	// CSI ? <params> c
+	return reply.starts_with('?') and reply.ends_with('c');
+}
+
+static std::string query(int in_fd, int out_fd, std::string_view request)
+{
+	// the request is followed by a device attributes request,
+	//   since all terminals respond to it, we know when to stop reading
+
+	std::string out { request };
+	out += esc::device_attributes;
+	::write(out_fd, out.data(), out.size());
+
+	std::string response;
+
+	static constexpr auto timeout { 500ms };
+	const auto start_time = std::chrono::steady_clock::now();
+
+	while(std::chrono::steady_clock::now() - start_time < timeout)
+	{
+		::pollfd pfd { .fd = in_fd, .events = POLLIN, .revents = 0 };
+		if(::poll(&pfd, 1, 50) <= 0)
+			continue;
+
+		char buf[64];
+		const auto n = ::read(in_fd, buf, sizeof(buf));
+		if(n <= 0)
+			break;
+		response.append(buf, std::size_t(n));
+
+		// other replies might also start with "CSI ?", e.g. DECRPM: CSI ? <mode> ; <status> $ y
+		std::size_t pos { 0 };
+		while(pos < response.size())
+		{
+			if(is_device_attributes(next_reply(response, pos)))
+				return response;
+		}
+	}
+
+	return response;  // (it might contain input typed meanwhile)
+}
+
+namespace term
+{
+
+Capabilities parse_capabilities(std::string_view response, std::string &input)
+{
+	Capabilities caps;
+
+	// the replies arrive in the same order as the requests, the device attributes reply is the last one.
+	//   anything else was typed by the user meanwhile (or is after the replies)
+	bool position_reported { false };
+	std::size_t pos { 0 };
+	while(pos < response.size())
+	{
+		const auto start = response.find("\x1b["sv, pos);
+		input.append(response.substr(pos, start - pos));
+		if(start == std::string_view::npos)
+			return caps;
+
+		pos = start;
+		const auto reply = next_reply(response, pos);
+		if(reply.empty())  // incomplete
+		{
+			input.append(response.substr(start));
+			return caps;
+		}
+
+		if(is_device_attributes(reply))
+			break;
+
+		const std::string params { reply };  // (null terminated, for sscanf)
+
+		// cursor position report: CSI <row> ; <column> R  (some keys look the same, e.g. ctrl+F3; the first one is taken)
+		std::size_t row { 0 };
+		std::size_t column { 0 };
+		// mode 2026 status (DECRPM): 0 = not recognized, 1 = set, 2 = reset, 3 = permanently set, 4 = permanently reset
+		int synch_status { 0 };
+
+		if(not position_reported and reply.ends_with('R') and std::sscanf(params.c_str(), "%zu;%zuR", &row, &column) == 2)
+		{
+			caps.repeat_char = column == 5;
+			position_reported = true;
+		}
+		else if(reply.ends_with("$y"sv) and std::sscanf(params.c_str(), "?2026;%d$y", &synch_status) == 1)
+			caps.synchronized_output = synch_status >= 1 and synch_status <= 3;
+		else
+			input.append(response.substr(start, pos - start));  // e.g. a cursor key
+	}
+
+	input.append(response.substr(pos));
+
+	return caps;
+}
+
 } // NS: term
 
 bool clear_in_flags(int fd, IOFlag flags)
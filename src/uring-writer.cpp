@@ -0,0 +1,264 @@
+#include <termic/uring-writer.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <poll.h>
+#include <unistd.h>
+
+
+namespace termic
+{
+
+// ids of the submissions, to tell their completions apart
+static constexpr std::uint64_t poll_id { 1 };
+static constexpr std::uint64_t write_id { 2 };
+static constexpr std::uint64_t cancel_id { 3 };
+
+UringWriter::UringWriter(int fd) :
+	_fd(fd)
+{
+	// a write, possibly preceded by a poll; a few entries is plenty
+	::io_uring_params params {};
+	const auto ring_fd = int(::syscall(__NR_io_uring_setup, 4u, &params));
+	if(ring_fd < 0)
+		return;
+
+	// both rings in one mapping (5.4), and writes at the current file position (5.6)
+	static constexpr auto required_features { IORING_FEAT_SINGLE_MMAP | IORING_FEAT_RW_CUR_POS };
+	if((params.features & required_features) != required_features)
+	{
+		::close(ring_fd);
+		return;
+	}
+
+	const auto ring_size = std::max(
+		params.sq_off.array + params.sq_entries*sizeof(unsigned),
+		params.cq_off.cqes + params.cq_entries*sizeof(::io_uring_cqe)
+	);
+	auto *ring = ::mmap(nullptr, ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+	if(ring == MAP_FAILED)
+	{
+		::close(ring_fd);
+		return;
+	}
+
+	const auto sqes_size = params.sq_entries*sizeof(::io_uring_sqe);
+	auto *sqes = ::mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+	if(sqes == MAP_FAILED)
+	{
+		::munmap(ring, ring_size);
+		::close(ring_fd);
+		return;
+	}
+
+	const auto at = [ring](std::uint32_t offset) {
+		return reinterpret_cast<unsigned *>(static_cast<char *>(ring) + offset);
+	};
+
+	_ring = ring;
+	_ring_size = ring_size;
+	_sqes = static_cast<::io_uring_sqe *>(sqes);
+	_sqes_size = sqes_size;
+
+	_sq_tail = at(params.sq_off.tail);
+	_sq_mask = at(params.sq_off.ring_mask);
+	_sq_array = at(params.sq_off.array);
+	_cq_head = at(params.cq_off.head);
+	_cq_tail = at(params.cq_off.tail);
+	_cq_mask = at(params.cq_off.ring_mask);
+	_cqes = reinterpret_cast<::io_uring_cqe *>(static_cast<char *>(ring) + params.cq_off.cqes);
+
+	_ring_fd = ring_fd;
+}
+
+UringWriter::~UringWriter()
+{
+	if(_ring_fd < 0)
+		return;
+
+	// the kernel might still read the data of the write in flight, which its owner releases after this
+	if(_in_flight)
+		cancel();
+
+	::munmap(_sqes, _sqes_size);
+	::munmap(_ring, _ring_size);
+	::close(_ring_fd);
+}
+
+void UringWriter::submit(const ::iovec *parts, std::size_t num_parts)
+{
+	num_parts = std::min(num_parts, max_parts);
+	std::copy(parts, parts + num_parts, _parts);
+	_first_part = 0;
+	_num_parts = num_parts;
+	_in_flight = true;
+	_empty_writes = 0;
+
+	submit_parts(false);
+}
+
+bool UringWriter::busy()
+{
+	if(not _in_flight)
+		return false;
+
+	if(_unsubmitted > 0)
+		enter();
+
+	while(_completions_due > 0)
+	{
+		// (the kernel only appends completions; we're the only one consuming them)
+		const auto head = *_cq_head;
+		if(head == std::atomic_ref(*_cq_tail).load(std::memory_order_acquire))
+			break;
+
+		const auto cqe = _cqes[head & *_cq_mask];
+		std::atomic_ref(*_cq_head).store(head + 1, std::memory_order_release);
+		--_completions_due;
+
+		if(cqe.user_data != write_id)  // the poll before the write
+			continue;
+
+		if(cqe.res == -EAGAIN)  // (a non-blocking fd) retry once it's writable
+			submit_parts(true);
+		else if(cqe.res == 0 and _empty_writes++ == 0)  // nothing accepted; try once more, when it's writable
+			submit_parts(true);
+		else if(cqe.res == -EINTR or cqe.res == -ECANCELED)  // (e.g. the submitting thread exited; nothing was written)
+			submit_parts(false);
+		else if(cqe.res <= 0)
+		{
+			++_errors;
+			_in_flight = false;
+		}
+		else
+		{
+			// continue after what was written, if it wasn't all of it
+			auto written = std::size_t(cqe.res);
+			_empty_writes = 0;
+			while(_first_part < _num_parts and written >= _parts[_first_part].iov_len)
+				written -= _parts[_first_part++].iov_len;
+
+			if(_first_part < _num_parts)
+			{
+				_parts[_first_part].iov_base = static_cast<char *>(_parts[_first_part].iov_base) + written;
+				_parts[_first_part].iov_len -= written;
+				submit_parts(false);
+			}
+			else
+				_in_flight = false;
+		}
+	}
+
+	return _in_flight;
+}
+
+std::size_t UringWriter::remaining() const
+{
+	std::size_t size { 0 };
+	if(_in_flight)
+	{
+		for(auto idx = _first_part; idx < _num_parts; ++idx)
+			size += _parts[idx].iov_len;
+	}
+	return size;
+}
+
+void UringWriter::submit_parts(bool wait_writable)
+{
+	auto tail = *_sq_tail;  // (only we're appending submissions)
+
+	const auto add = [this, &tail](const ::io_uring_sqe &sqe) {
+		const auto index = tail & *_sq_mask;
+		_sqes[index] = sqe;
+		_sq_array[index] = index;
+		++tail;
+	};
+
+	if(wait_writable)
+	{
+		::io_uring_sqe poll {};
+		poll.opcode = IORING_OP_POLL_ADD;
+		poll.flags = IOSQE_IO_LINK;  // the write starts when this completes
+		poll.fd = _fd;
+		poll.poll32_events = POLLOUT;
+		poll.user_data = poll_id;
+		add(poll);
+	}
+
+	::io_uring_sqe write {};
+	write.opcode = IORING_OP_WRITEV;
+	// always in a kernel worker; e.g. terminals don't honour "no wait" writes, and would block the submitter
+	write.flags = IOSQE_ASYNC;
+	write.fd = _fd;
+	write.off = std::uint64_t(-1);  // at the current position, i.e. like write()
+	write.addr = reinterpret_cast<std::uint64_t>(_parts + _first_part);
+	write.len = unsigned(_num_parts - _first_part);
+	write.user_data = write_id;
+	add(write);
+
+	const auto added { wait_writable? 2u: 1u };
+	std::atomic_ref(*_sq_tail).store(tail, std::memory_order_release);
+	_unsubmitted += added;
+	_completions_due += added;
+
+	enter();
+}
+
+void UringWriter::cancel()
+{
+	// both the write and the poll that might precede it
+	auto tail = *_sq_tail;
+	for(const auto id: { poll_id, write_id })
+	{
+		::io_uring_sqe cancel {};
+		cancel.opcode = IORING_OP_ASYNC_CANCEL;
+		cancel.addr = id;
+		cancel.user_data = cancel_id;
+
+		const auto index = tail & *_sq_mask;
+		_sqes[index] = cancel;
+		_sq_array[index] = index;
+		++tail;
+	}
+	std::atomic_ref(*_sq_tail).store(tail, std::memory_order_release);
+	_unsubmitted += 2;
+	_completions_due += 2;
+	enter();
+	_completions_due -= std::min(_completions_due, _unsubmitted);  // (what the kernel didn't take, it never completes)
+
+	// wait until all of them completed (whether cancelled, or finished anyway)
+	while(_completions_due > 0)
+	{
+		const auto head = *_cq_head;
+		if(head != std::atomic_ref(*_cq_tail).load(std::memory_order_acquire))
+		{
+			std::atomic_ref(*_cq_head).store(head + 1, std::memory_order_release);
+			--_completions_due;
+		}
+		else if(::syscall(__NR_io_uring_enter, _ring_fd, 0u, 1u, IORING_ENTER_GETEVENTS, nullptr, 0ul) == -1 and errno != EINTR)
+			break;
+	}
+
+	_in_flight = false;
+}
+
+void UringWriter::enter()
+{
+	while(_unsubmitted > 0)
+	{
+		const auto rc = ::syscall(__NR_io_uring_enter, _ring_fd, _unsubmitted, 0u, 0u, nullptr, 0ul);
+		if(rc > 0)
+			_unsubmitted -= unsigned(rc);
+		else if(rc == -1 and errno == EINTR)
+			continue;
+		else
+			break;  // e.g. EAGAIN (out of resources); tried again by busy()
+	}
+}
+
+} // NS: termic
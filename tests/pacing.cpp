@@ -0,0 +1,125 @@
+#include <termic/pacing.h>
+using namespace  termic;
+
+using namespace std::literals;
+
+#include <catch2/catch.hpp>
+
+
+TEST_CASE("Updates without a frame interval", "FramePacer") {
+	FramePacer pacer;
+	const auto t0 = FramePacer::Clock::now();
+
+	REQUIRE(pacer.due(t0));
+	pacer.updated(t0);
+	REQUIRE(pacer.due(t0));
+	REQUIRE(pacer.wait(t0) == FramePacer::min_wait);
+}
+
+TEST_CASE("Updates are postponed until the frame interval passed", "FramePacer") {
+	FramePacer pacer;
+	pacer.interval = 10ms;
+	const auto t0 = FramePacer::Clock::now();
+
+	// the first one is due immediately
+	REQUIRE(pacer.due(t0));
+	pacer.updated(t0);
+
+	// too soon, wait for the rest of the interval
+	REQUIRE(not pacer.due(t0 + 5ms));
+	REQUIRE(pacer.wait(t0 + 5ms) == 5ms);
+
+	// a continued update isn't postponed
+	REQUIRE(pacer.due(t0 + 5ms, true));
+
+	// the last bit isn't waited for exactly, but at least a little
+	REQUIRE(not pacer.due(t0 + 9ms));
+	REQUIRE(pacer.wait(t0 + 9ms) == FramePacer::min_wait);
+
+	// due; if it's dropped, it's retried a bit later
+	REQUIRE(pacer.due(t0 + 10ms));
+	REQUIRE(pacer.wait(t0 + 25ms) == FramePacer::min_wait);
+
+	// the next interval starts with the next update
+	pacer.updated(t0 + 25ms);
+	REQUIRE(not pacer.due(t0 + 30ms));
+	REQUIRE(pacer.due(t0 + 35ms));
+}
+
+TEST_CASE("Resizes without debouncing", "ResizeDebouncer") {
+	ResizeDebouncer resize;
+	const auto t0 = ResizeDebouncer::Clock::now();
+
+	REQUIRE(resize.due(t0) == ResizeDebouncer::NotDue);
+	REQUIRE(not resize.wait(t0));
+
+	// due immediately
+	resize.signalled(1, t0);
+	REQUIRE(resize.burst() == 1);
+	REQUIRE(resize.due(t0) == ResizeDebouncer::Final);
+	REQUIRE(resize.wait(t0) == 0us);
+
+	// a single resize doesn't need a repaint
+	REQUIRE(not resize.resized(t0, false));
+	REQUIRE(resize.burst() == 0);
+	REQUIRE(resize.due(t0) == ResizeDebouncer::NotDue);
+	REQUIRE(not resize.wait(t0));
+
+	// no signals, nothing changes
+	resize.signalled(0, t0);
+	REQUIRE(resize.due(t0) == ResizeDebouncer::NotDue);
+}
+
+TEST_CASE("A burst of resizes is coalesced", "ResizeDebouncer") {
+	ResizeDebouncer resize;
+	resize.settle = 50ms;
+	const auto t0 = ResizeDebouncer::Clock::now();
+
+	// each signal postpones the resize
+	resize.signalled(1, t0);
+	REQUIRE(resize.due(t0 + 30ms) == ResizeDebouncer::NotDue);
+	REQUIRE(resize.wait(t0 + 30ms) == 20ms);
+
+	resize.signalled(2, t0 + 40ms);
+	REQUIRE(resize.burst() == 3);
+	REQUIRE(resize.due(t0 + 60ms) == ResizeDebouncer::NotDue);
+	REQUIRE(resize.wait(t0 + 60ms) == 30ms);
+
+	// settled; one resize, repainted (the terminal's content is unknown)
+	REQUIRE(resize.due(t0 + 90ms) == ResizeDebouncer::Final);
+	REQUIRE(resize.wait(t0 + 100ms) == 0us);
+	REQUIRE(resize.resized(t0 + 90ms, false));
+	REQUIRE(resize.burst() == 0);
+	REQUIRE(resize.due(t0 + 200ms) == ResizeDebouncer::NotDue);
+	REQUIRE(not resize.wait(t0 + 200ms));
+}
+
+TEST_CASE("Intermediate resizes during a burst", "ResizeDebouncer") {
+	ResizeDebouncer resize;
+	resize.settle = 50ms;
+	resize.intermediate = 100ms;
+	const auto t0 = ResizeDebouncer::Clock::now();
+	resize.resized(t0, false);
+
+	// signals keep coming; an intermediate resize is due after the interval
+	for(auto t = 10ms; t < 100ms; t += 10ms)
+	{
+		resize.signalled(1, t0 + t);
+		REQUIRE(resize.due(t0 + t) == ResizeDebouncer::NotDue);
+	}
+	REQUIRE(resize.wait(t0 + 90ms) == 10ms);
+
+	resize.signalled(1, t0 + 100ms);
+	REQUIRE(resize.due(t0 + 100ms) == ResizeDebouncer::Intermediate);
+	REQUIRE(resize.resized(t0 + 100ms, true));
+
+	// the final one is still due, once it settled (not the next intermediate one; nothing changed since)
+	REQUIRE(resize.burst() == 0);
+	REQUIRE(resize.wait(t0 + 110ms) == 40ms);
+	REQUIRE(resize.due(t0 + 149ms) == ResizeDebouncer::NotDue);
+	REQUIRE(resize.due(t0 + 150ms) == ResizeDebouncer::Final);
+
+	// only one more resize; the terminal showed what the screen had, no repaint
+	REQUIRE(not resize.resized(t0 + 150ms, false));
+	REQUIRE(resize.due(t0 + 300ms) == ResizeDebouncer::NotDue);
+}
@@ -0,0 +1,1394 @@
+#include <termic/screen.h>
+#include <termic/screen-buffer.h>
+#include <termic/canvas.h>
+using namespace  termic;
+
+using namespace std::literals;
+
+#include <catch2/catch.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include <utility>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <new>
+#include <thread>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/resource.h>
+
+// count heap allocations, to check that updates don't need any
+static std::atomic<std::size_t> g_allocations { 0 };
+
+void *operator new(std::size_t size)
+{
+	++g_allocations;
+	if(auto *ptr = std::malloc(size))
+		return ptr;
+	throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept
+{
+	std::free(ptr);
+}
+
+namespace
+{
+
+// a screen writing to a temporary file, so the output can be inspected
+struct TestScreen
+{
+	TestScreen(Size size) :
+		_file(std::tmpfile()),
+		screen(::fileno(_file))
+	{
+		screen.set_size(size);
+	}
+	~TestScreen()
+	{
+		std::fclose(_file);
+	}
+
+	// everything written by the screen since the previous call
+	std::string output()
+	{
+		const auto end = ::lseek(::fileno(_file), 0, SEEK_END);
+
+		std::string out;
+		out.resize(std::size_t(end - _read_pos));
+		[[maybe_unused]] auto rc = ::pread(::fileno(_file), out.data(), out.size(), _read_pos);
+		_read_pos = end;
+
+		return out;
+	}
+
+private:
+	std::FILE *_file;
+	off_t _read_pos { 0 };
+
+public:
+	Screen screen;
+};
+
+
+// a pseudo terminal, whose output nobody reads (until the test does)
+struct TestPty
+{
+	TestPty()
+	{
+		master = ::posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+		if(master >= 0 and ::grantpt(master) == 0 and ::unlockpt(master) == 0)
+			slave = ::open(::ptsname(master), O_RDWR | O_NOCTTY);
+	}
+	~TestPty()
+	{
+		if(slave >= 0)
+			::close(slave);
+		if(master >= 0)
+			::close(master);
+	}
+	TestPty(const TestPty &) = delete;
+	TestPty &operator = (const TestPty &) = delete;
+
+	// everything the terminal received since the previous call
+	std::string read()
+	{
+		std::string received;
+		char buf[4096];
+		for(ssize_t len; (len = ::read(master, buf, sizeof(buf))) > 0; )
+			received.append(buf, std::size_t(len));
+		return received;
+	}
+
+	// fill the terminal's buffer, so it doesn't accept more output (until it's read)
+	void fill()
+	{
+		::fcntl(slave, F_SETFL, ::fcntl(slave, F_GETFL) | O_NONBLOCK);
+		const std::string filler(1024, 'x');
+		while(::write(slave, filler.data(), filler.size()) > 0)
+			;
+		::fcntl(slave, F_SETFL, ::fcntl(slave, F_GETFL) & ~O_NONBLOCK);
+	}
+
+	int master { -1 };
+	int slave { -1 };
+};
+
+// a minimal terminal, replaying (ASCII) output, to check what it ends up showing
+struct TestTerminal
+{
+	struct Cell
+	{
+		char ch { ' ' };
+		std::string fg;  // "r;g;b", empty: default
+		std::string bg;
+
+		bool operator == (const Cell &) const = default;
+	};
+
+	TestTerminal(Size size) :
+		_size(size),
+		_cells(size.width*size.height)
+	{
+	}
+
+	void feed(std::string_view out)
+	{
+		for(auto idx = 0ul; idx < out.size(); ++idx)
+		{
+			const auto c = out[idx];
+			if(c == '\x1b' and idx + 1 < out.size() and out[idx + 1] == '[')
+			{
+				auto end = idx + 2;
+				while(end < out.size() and (out[end] < 0x40 or out[end] > 0x7e))
+					++end;
+				if(end == out.size())
+					break;
+				csi(out.substr(idx + 2, end - idx - 2), out[end]);
+				idx = end;
+			}
+			else if(c == '\r')
+				_x = 0;
+			else if(c == '\n')
+				_y = std::min(_y + 1, _size.height - 1);
+			else if(c == '\b')
+				_x = _x > 0? std::min(_x, _size.width) - 1: 0;
+			else
+			{
+				if(_x == _size.width)  // auto-wrap
+				{
+					_x = 0;
+					_y = std::min(_y + 1, _size.height - 1);
+				}
+				at(_x++, _y) = { c, c == ' '? "": _fg, _bg };
+			}
+		}
+	}
+
+	inline const Cell &cell(std::size_t x, std::size_t y) const { return _cells[y*_size.width + x]; }
+	inline bool operator == (const TestTerminal &other) const { return _cells == other._cells; }
+
+	std::string unsupported;  // sequences it doesn't know
+
+private:
+	inline Cell &at(std::size_t x, std::size_t y) { return _cells[y*_size.width + x]; }
+
+	void erase(std::size_t y, std::size_t from, std::size_t to)
+	{
+		for(auto x = from; x < std::min(to, _size.width); ++x)
+			at(x, y) = { ' ', "", _bg };
+	}
+
+	// insert (positive) or delete blank cells, shifting the rest of the row
+	void shift(std::size_t y, std::size_t from, int cells)
+	{
+		const auto row = _cells.begin() + std::ptrdiff_t(y*_size.width);
+		const auto n = std::min(std::size_t(std::abs(cells)), _size.width - from);
+		if(cells > 0)
+			std::move_backward(row + std::ptrdiff_t(from), row + std::ptrdiff_t(_size.width - n), row + std::ptrdiff_t(_size.width));
+		else
+			std::move(row + std::ptrdiff_t(from + n), row + std::ptrdiff_t(_size.width), row + std::ptrdiff_t(from));
+		erase(y, cells > 0? from: _size.width - n, cells > 0? from + n: _size.width);
+	}
+
+	void csi(std::string_view params, char command)
+	{
+		std::vector<std::size_t> args;
+		for(auto pos = 0ul; pos <= params.size(); )
+		{
+			const auto end = std::min(params.find(';', pos), params.size());
+			std::size_t n { 0 };
+			for(const auto c: params.substr(pos, end - pos))
+				n = n*10 + std::size_t(c - '0');
+			args.push_back(n);
+			pos = end + 1;
+		}
+		const auto arg = [&args](std::size_t idx) { return idx < args.size() and args[idx] > 0? args[idx]: 1ul; };
+
+		const auto x = std::min(_x, _size.width - 1);
+		switch(command)
+		{
+		case 'H': _y = arg(0) - 1; _x = arg(1) - 1; break;
+		case 'G': _x = arg(0) - 1; break;
+		case 'd': _y = arg(0) - 1; break;
+		case 'A': _y -= std::min(_y, arg(0)); break;
+		case 'B': _y = std::min(_y + arg(0), _size.height - 1); break;
+		case 'C': _x = std::min(x + arg(0), _size.width - 1); break;
+		case 'D': _x = x - std::min(x, arg(0)); break;
+		case 'X': erase(_y, x, x + arg(0)); break;
+		case '@': shift(_y, x, int(arg(0))); break;
+		case 'P': shift(_y, x, -int(arg(0))); break;
+		case 'K':
+			if(args[0] == 0)
+				erase(_y, x, _size.width);
+			else
+				erase(_y, args[0] == 1? 0: x, args[0] == 1? x + 1: _size.width);
+			break;
+		case 'J':
+			for(auto y = 0ul; y < _size.height; ++y)
+				erase(y, 0, _size.width);
+			break;
+		case 'm':
+			for(auto idx = 0ul; idx < args.size(); ++idx)
+			{
+				if(args[idx] == 0)
+					_fg.clear(), _bg.clear();
+				else if(args[idx] == 39)
+					_fg.clear();
+				else if(args[idx] == 49)
+					_bg.clear();
+				else if((args[idx] == 38 or args[idx] == 48) and idx + 4 < args.size())
+				{
+					(args[idx] == 38? _fg: _bg) = fmt::format("{};{};{}", args[idx + 2], args[idx + 3], args[idx + 4]);
+					idx += 4;
+				}
+			}
+			break;
+		default:
+			unsupported += command;
+		}
+	}
+
+private:
+	Size _size;
+	std::vector<Cell> _cells;
+	std::size_t _x { 0 };
+	std::size_t _y { 0 };
+	std::string _fg;
+	std::string _bg;
+};
+
+} // anon NS
+
+TEST_CASE("Dirty row tracking", "ScreenBuffer::dirty") {
+	ScreenBuffer buffer;
+	buffer.set_size({ 10, 4 });
+
+	// a resize makes everything dirty
+	for(auto y = 0u; y < 4; ++y)
+	{
+		REQUIRE(buffer.is_dirty(y));
+		buffer.clear_dirty(y);
+		REQUIRE(not buffer.is_dirty(y));
+	}
+
+	buffer.set_cell({ 3, 1 }, "a", 1);
+	buffer.set_cell({ 7, 1 }, "b", 1);
+	REQUIRE(not buffer.is_dirty(0));
+	REQUIRE(buffer.is_dirty(1));
+	REQUIRE(buffer.dirty_span(1).first == 3);
+	REQUIRE(buffer.dirty_span(1).last == 7);
+	REQUIRE(not buffer.is_dirty(2));
+
+	buffer.clear({ { 2, 2 }, { 3, 2 } }, color::Default);
+	REQUIRE(buffer.dirty_span(2).first == 2);
+	REQUIRE(buffer.dirty_span(2).last == 4);
+	REQUIRE(buffer.dirty_span(3).first == 2);
+	REQUIRE(buffer.dirty_span(3).last == 4);
+
+	// (non-const) cell access marks the cell, reading does not
+	buffer.clear_dirty(3);
+	std::as_const(buffer).cell({ 9, 3 });
+	REQUIRE(not buffer.is_dirty(3));
+	buffer.cell({ 9, 3 }).look.bg = color::Red;
+	REQUIRE(buffer.dirty_span(3).first == 9);
+	REQUIRE(buffer.dirty_span(3).last == 9);
+}
+
+TEST_CASE("Update only writes changed cells", "Screen::update") {
+	TestScreen ts({ 20, 5 });
+	auto &screen = ts.screen;
+
+	screen.print({ 2, 1 }, "hello");
+	screen.update();
+	REQUIRE(ts.output().find("hello") != std::string::npos);
+
+	// same content again -> no cells written
+	screen.print({ 2, 1 }, "hello");
+	screen.update();
+	REQUIRE(ts.output().find("hello") == std::string::npos);
+
+	screen.print({ 2, 1 }, "help");
+	screen.update();
+	const auto out = ts.output();
+	REQUIRE(out.find("p") != std::string::npos);
+	REQUIRE(out.find("hel") == std::string::npos);
+}
+
+TEST_CASE("Rectangle intersection and union", "Rectangle") {
+	const Rectangle a { { 2, 2 }, { 4, 3 } };
+	const Rectangle b { { 4, 3 }, { 5, 5 } };
+
+	const auto i = a.intersection(b);
+	REQUIRE(i.top_left.x == 4);
+	REQUIRE(i.top_left.y == 3);
+	REQUIRE(i.size == Size{ 2, 2 });
+
+	REQUIRE(a.intersection({ { 10, 10 }, { 1, 1 } }).empty());
+
+	const auto u = a.united(b);
+	REQUIRE(u.top_left.x == 2);
+	REQUIRE(u.top_left.y == 2);
+	REQUIRE(u.size == Size{ 7, 6 });
+}
+
+TEST_CASE("Invalidated areas are compared", "Screen::invalidate") {
+	TestScreen ts({ 20, 5 });
+	auto &screen = ts.screen;
+
+	screen.print({ 0, 0 }, "abc");
+	screen.update();
+	ts.output();
+
+	// nothing changed, so nothing to write even if invalidated
+	screen.invalidate({ { 0, 0 }, { 5, 2 } });
+	REQUIRE(screen.dirty());
+	screen.update();
+	REQUIRE(not screen.dirty());
+	REQUIRE(ts.output().empty());
+
+	// clipped to the screen; the part inside it is still compared
+	screen.invalidate({ { 18, 4 }, { 10, 10 } });
+	REQUIRE(screen.dirty());
+	screen.update();
+	REQUIRE(not screen.dirty());
+	REQUIRE(ts.output().empty());
+
+	// completely outside
+	screen.invalidate({ { 25, 2 }, { 10, 10 } });
+	REQUIRE(not screen.dirty());
+}
+
+TEST_CASE("Row hashes follow the content", "ScreenBuffer::row_hash") {
+	ScreenBuffer a;
+	ScreenBuffer b;
+	a.set_size({ 10, 3 });
+	b.set_size({ 10, 3 });
+	a.clear();
+	b.clear();
+	REQUIRE(a.row_hash(0) == b.row_hash(0));
+
+	a.set_cell({ 1, 0 }, "x", 1, { color::Red });
+	REQUIRE(a.row_hash(0) != b.row_hash(0));
+	REQUIRE(a.row_hash(1) == b.row_hash(1));
+
+	// same content, written in a different way
+	b.cell({ 1, 0 }).ch[0] = 'x';
+	b.cell({ 1, 0 }).look.fg = color::Red;
+	REQUIRE(a.row_hash(0) == b.row_hash(0));
+
+	// same character in another column
+	a.set_cell({ 1, 1 }, "y", 1);
+	b.set_cell({ 2, 1 }, "y", 1);
+	REQUIRE(a.row_hash(1) != b.row_hash(1));
+
+	a.clear({ { 1, 0 }, { 1, 1 } }, color::Default, color::Default);
+	b.clear();
+	REQUIRE(a.row_hash(0) == b.row_hash(0));
+}
+
+TEST_CASE("Redrawing the same content writes nothing", "Screen::update") {
+	TestScreen ts({ 30, 5 });
+	auto &screen = ts.screen;
+
+	auto draw = [&screen]() {
+		screen.clear();
+		screen.print({ 1, 1 }, "some text", { color::Yellow });
+		screen.print({ 3, 3 }, "more text");
+	};
+
+	draw();
+	screen.update();
+	REQUIRE(ts.output().find("some text") != std::string::npos);
+
+	draw();
+	screen.update();
+	REQUIRE(ts.output().find("text") == std::string::npos);
+}
+
+TEST_CASE("Copying a span of a row", "ScreenBuffer::copy_span") {
+	ScreenBuffer src;
+	ScreenBuffer dst;
+	src.set_size({ 10, 2 });
+	dst.set_size({ 10, 2 });
+	src.clear();
+	dst.clear();
+
+	src.set_cell({ 4, 1 }, "a", 1);
+	src.set_cell({ 6, 1 }, "b", 1);
+	REQUIRE(src.row_hash(1) != dst.row_hash(1));
+
+	dst.copy_span(src, 1, src.dirty_span(1));
+	REQUIRE(dst.cell({ 4, 1 }) == src.cell({ 4, 1 }));
+	REQUIRE(dst.cell({ 6, 1 }) == src.cell({ 6, 1 }));
+	REQUIRE(dst.row_hash(1) == src.row_hash(1));
+	REQUIRE(dst.row_hash(0) == src.row_hash(0));
+}
+
+TEST_CASE("Clearing is lazy, but looks immediate", "ScreenBuffer::clear") {
+	ScreenBuffer a;
+	a.set_size({ 10, 4 });
+	for(auto y = 0u; y < 4; ++y)
+		for(auto x = 0u; x < 10; ++x)
+			a.set_cell({ x, y }, "x", 1, { color::Red, style::Bold, color::Blue });
+
+	a.clear(color::Green, color::White);
+	REQUIRE(a.is_dirty(3));
+	REQUIRE(a.cell({ 4, 2 }).ch[0] == '\0');
+	REQUIRE(a.cell({ 4, 2 }).look.bg == color::Green);
+	REQUIRE(a.cell({ 9, 3 }).look.style == style::Default);
+
+	// the same as if each cell was cleared
+	ScreenBuffer b;
+	b.set_size({ 10, 4 });
+	b.clear({ { 0, 0 }, { 10, 4 } }, color::Green, color::White);
+	for(auto y = 0u; y < 4; ++y)
+		REQUIRE(a.row_hash(y) == b.row_hash(y));
+
+	a.set_cell({ 2, 1 }, "y", 1);
+	b.set_cell({ 2, 1 }, "y", 1);
+	REQUIRE(a.cell({ 1, 1 }) == b.cell({ 1, 1 }));
+	REQUIRE(a.row_hash(1) == b.row_hash(1));
+
+	// lazily cleared rows can be moved
+	a.clear(color::Red, color::White);
+	b.clear({ { 0, 0 }, { 10, 4 } }, color::Red, color::White);
+	a.set_cell({ 5, 3 }, "z", 1);
+	b.set_cell({ 5, 3 }, "z", 1);
+	a.scroll(0, 3, 1);
+	b.scroll(0, 3, 1);
+	for(auto y = 0u; y < 4; ++y)
+	{
+		REQUIRE(a.row_hash(y) == b.row_hash(y));
+		REQUIRE(a.cell({ 5, y }) == b.cell({ 5, y }));
+	}
+}
+
+TEST_CASE("Resizing keeps the content", "ScreenBuffer::set_size") {
+	ScreenBuffer buffer;
+	buffer.preserve_content = true;
+	buffer.set_size({ 10, 4 });
+	for(auto y = 0u; y < 4; ++y)
+		buffer.set_cell({ 1, y }, std::string(1, char('a' + y)), 1);
+	buffer.set_cell({ 4, 1 }, "界", 2);
+	buffer.set_cell({ 5, 1 }, " ", 0);
+
+	buffer.set_size({ 16, 6 });
+	for(auto y = 0u; y < 4; ++y)
+		REQUIRE(buffer.cell({ 1, y }).ch[0] == char('a' + y));
+	REQUIRE(buffer.cell({ 12, 2 }).ch[0] == '\0');
+	REQUIRE(buffer.cell({ 1, 5 }).ch[0] == '\0');
+
+	// cutting the double width character in half
+	buffer.set_size({ 5, 3 });
+	for(auto y = 0u; y < 3; ++y)
+		REQUIRE(buffer.cell({ 1, y }).ch[0] == char('a' + y));
+	REQUIRE(std::string_view(buffer.cell({ 4, 1 }).ch) == " ");
+	REQUIRE(buffer.cell({ 4, 1 }).width == 1);
+}
+
+TEST_CASE("Blitting keeps row hashes correct", "ScreenBuffer::blit") {
+	ScreenBuffer src;
+	ScreenBuffer dst;
+	ScreenBuffer expected;
+	src.set_size({ 10, 3 });
+	dst.set_size({ 10, 3 });
+	expected.set_size({ 10, 3 });
+	src.clear();
+	dst.clear();
+	expected.clear();
+
+	src.set_cell({ 2, 0 }, "a", 1);
+	src.set_cell({ 3, 1 }, "b", 1);
+	(void)dst.row_hash(0);
+	dst.clear_dirty();
+
+	// whole rows, into the next row
+	dst.blit(src, { { 0, 0 }, { 10, 1 } }, { 0, 1 });
+	expected.set_cell({ 2, 1 }, "a", 1);
+	REQUIRE(dst.row_hash(1) == expected.row_hash(1));
+	REQUIRE(dst.dirty_span(1).first == 0);
+
+	// a part, moved right and clipped
+	dst.blit(src, { { 2, 1 }, { 5, 2 } }, { 8, 0 });
+	expected.set_cell({ 9, 0 }, "b", 1);
+	REQUIRE(dst.cell({ 9, 0 }) == expected.cell({ 9, 0 }));
+	REQUIRE(dst.row_hash(0) == expected.row_hash(0));
+	REQUIRE(dst.dirty_span(0).first == 8);
+	REQUIRE(dst.row_hash(2) == expected.row_hash(2));
+
+	// half of a double width character
+	src.set_cell({ 5, 2 }, "界", 2);
+	src.set_cell({ 6, 2 }, " ", 0);
+	dst.blit(src, { { 0, 2 }, { 6, 1 } }, { 0, 2 });
+	REQUIRE(std::string_view(dst.cell({ 5, 2 }).ch) == " ");
+	REQUIRE(dst.cell({ 5, 2 }).width == 1);
+}
+
+TEST_CASE("Scrolled rows are moved by the terminal", "Screen::update") {
+	TestScreen ts({ 40, 10 });
+	auto &screen = ts.screen;
+
+	auto draw_log = [&screen](int first) {
+		for(auto y = 0u; y < 10; ++y)
+			screen.print({ 0, y }, fmt::format("log line number {:03d}", first + int(y)));
+	};
+
+	draw_log(0);
+	screen.update();
+	ts.output();
+
+	draw_log(1);
+	screen.update();
+	const auto out = ts.output();
+
+	REQUIRE(out.find("\x1b[1;10r\x1b[1S") != std::string::npos);
+	// only the new line is written
+	REQUIRE(out.find("010") != std::string::npos);
+	REQUIRE(out.find("005") == std::string::npos);
+}
+
+TEST_CASE("Inserted and deleted characters are shifted by the terminal", "Screen::update") {
+	TestScreen ts({ 60, 3 });
+	auto &screen = ts.screen;
+
+	screen.print({ 0, 1 }, "the quick brown fox jumps over the lazy dog");
+	screen.update();
+	ts.output();
+
+	screen.print({ 0, 1 }, "the quick red brown fox jumps over the lazy dog");
+	screen.update();
+	auto out = ts.output();
+	REQUIRE(out.find("\x1b[4@") != std::string::npos);
+	REQUIRE(out.find("red ") != std::string::npos);
+	REQUIRE(out.find("lazy") == std::string::npos);
+
+	screen.print({ 0, 1 }, "the quick brown fox jumps over the lazy dog    ");
+	screen.update();
+	out = ts.output();
+	REQUIRE(out.find("\x1b[4P") != std::string::npos);
+	REQUIRE(out.find("lazy") == std::string::npos);
+}
+
+TEST_CASE("Blank runs are erased instead of written", "Screen::update") {
+	TestScreen ts({ 80, 20 });
+	auto &screen = ts.screen;
+
+	const std::string line(80, '#');
+	for(auto y = 0u; y < 20; ++y)
+		screen.print({ 0, y }, line);
+	screen.update();
+	ts.output();
+
+	// mostly blank -> erase the whole screen
+	screen.clear();
+	screen.print({ 10, 10 }, "hello");
+	screen.update();
+	auto out = ts.output();
+	REQUIRE(out.find("\x1b[2J") != std::string::npos);
+	REQUIRE(out.size() < 100);
+
+	// (not repeating, to avoid matching shifted text)
+	std::string text;
+	for(auto x = 0u; x < 80; ++x)
+		text += char('a' + (x*7) % 26);
+
+	// the end of a row -> erase line
+	screen.print({ 0, 5 }, text);
+	screen.update();
+	ts.output();
+	screen.clear({ { 40, 5 }, { 40, 1 } }, color::Default, color::Default);
+	screen.update();
+	out = ts.output();
+	REQUIRE(out.find("\x1b[K") != std::string::npos);
+	REQUIRE(out.find(' ') == std::string::npos);
+
+	// inside a row -> erase characters
+	screen.print({ 0, 6 }, text);
+	screen.update();
+	ts.output();
+	screen.clear({ { 10, 6 }, { 30, 1 } }, color::Default, color::Default);
+	screen.update();
+	out = ts.output();
+	REQUIRE(out.find("\x1b[30X") != std::string::npos);
+}
+
+TEST_CASE("Repeated characters use REP", "Screen::update") {
+	TestScreen ts({ 80, 10 });
+	auto &screen = ts.screen;
+	screen.update();
+	ts.output();
+
+	std::string line;
+	for(auto x = 0u; x < 40; ++x)
+		line += "━";
+
+	// not supported -> written out in full
+	screen.print({ 0, 2 }, line);
+	screen.update();
+	auto out = ts.output();
+	REQUIRE(out.find("\x1b[39b") == std::string::npos);
+	REQUIRE(out.size() > line.size());
+
+	screen.capabilities.repeat_char = true;
+
+	screen.print({ 0, 3 }, line);
+	screen.update();
+	REQUIRE(ts.output() == "\x1b[4H━\x1b[39b\x1b[H");
+
+	// too short to be worth it
+	screen.print({ 0, 4 }, "aaa");
+	screen.update();
+	REQUIRE(ts.output() == "\x1b[5Haaa\x1b[H");
+
+	// not repeated over what the terminal already shows
+	//   (a run too short to be shifted, instead)
+	screen.print({ 0, 6 }, "-----x-------abcdefgh");
+	screen.update();
+	ts.output();
+	screen.print({ 5, 6 }, "-");
+	screen.update();
+	REQUIRE(ts.output() == "\x1b[7;6H-\x1b[H");
+}
+
+TEST_CASE("Short gaps are bridged by re-writing", "Screen::update") {
+	TestScreen ts({ 80, 10 });
+	auto &screen = ts.screen;
+
+	screen.print({ 2, 2 }, "12:34");
+	screen.print({ 40, 2 }, "7890");
+	screen.update();
+	ts.output();
+
+	// the unchanged cells between are shorter than a cursor movement
+	screen.print({ 2, 2 }, "13:35");
+	screen.update();
+	auto out = ts.output();
+	REQUIRE(out.find("3:35") != std::string::npos);
+
+	// ...but not a long gap
+	screen.print({ 2, 2 }, "23:35");
+	screen.print({ 40, 2 }, "7891");
+	screen.update();
+	out = ts.output();
+	REQUIRE(out.find("2\x1b[44G1") != std::string::npos);
+}
+
+TEST_CASE("Cursor movement uses the shortest sequence", "Screen::cursor_move") {
+	TestScreen ts({ 80, 10 });
+	auto &screen = ts.screen;
+	screen.update();
+	ts.output();
+
+	// beginning of the next line
+	screen.print({ 70, 3 }, "a");
+	screen.print({ 0, 4 }, "b");
+	screen.update();
+	auto out = ts.output();
+	REQUIRE(out.find("a\r\nb") != std::string::npos);
+
+	// same column, rows below
+	screen.print({ 20, 5 }, "c");
+	screen.print({ 20, 8 }, "d");
+	screen.update();
+	out = ts.output();
+	REQUIRE(out.find("c\b\x1b[9dd") != std::string::npos);
+
+	// back to the origin
+	REQUIRE(out.substr(out.size() - 3) == "\x1b[H");
+}
+
+TEST_CASE("Synchronized output brackets each update", "Screen::update") {
+	TestScreen ts({ 80, 10 });
+	auto &screen = ts.screen;
+	screen.capabilities.synchronized_output = true;
+	screen.update();
+	ts.output();
+
+	screen.print({ 2, 2 }, "hello");
+	screen.update();
+	auto out = ts.output();
+	REQUIRE(out.starts_with("\x1b[?2026h"));
+	REQUIRE(out.ends_with("\x1b[?2026l"));
+	REQUIRE(out.find("hello") != std::string::npos);
+
+	// nothing changed, nothing written
+	screen.update();
+	REQUIRE(ts.output().empty());
+}
+
+TEST_CASE("Capabilities are detected from the terminal's replies", "term::parse_capabilities") {
+	std::string input;
+
+	// cursor position, synchronized output mode status, device attributes
+	auto caps = term::parse_capabilities("\x1b[1;5R\x1b[?2026;2$y\x1b[?62;22c"sv, input);
+	REQUIRE(caps.repeat_char);
+	REQUIRE(caps.synchronized_output);
+	REQUIRE(input.empty());
+
+	// REP not supported (the cursor didn't move), mode 2026 not recognized
+	caps = term::parse_capabilities("\x1b[1;2R\x1b[?2026;0$y\x1b[?62;22c"sv, input);
+	REQUIRE(not caps.repeat_char);
+	REQUIRE(not caps.synchronized_output);
+
+	// mode 2026 not answered at all
+	caps = term::parse_capabilities("\x1b[1;5R\x1b[?1;2c"sv, input);
+	REQUIRE(caps.repeat_char);
+	REQUIRE(not caps.synchronized_output);
+	REQUIRE(input.empty());
+
+	// no reply
+	caps = term::parse_capabilities(""sv, input);
+	REQUIRE(not caps.repeat_char);
+	REQUIRE(not caps.synchronized_output);
+	REQUIRE(input.empty());
+
+	// keys typed while waiting for the replies are kept, in order
+	caps = term::parse_capabilities("ab\x1b[1;5R\x1b[Ac\x1b[?2026;1$y\x1b[?62c\x1b[Bd\x1b["sv, input);
+	REQUIRE(caps.repeat_char);
+	REQUIRE(caps.synchronized_output);
+	REQUIRE(input == "ab\x1b[Ac\x1b[Bd\x1b[");
+}
+
+TEST_CASE("Large changes are rendered in concurrent bands", "Screen::render_bands") {
+	// enough changed cells for 4 bands (of 50 rows)
+	static constexpr Size size { 640, 200 };
+
+	const auto draw = [](Screen &screen) {
+		screen.update();
+		for(auto y = 0ul; y < size.height; ++y)
+		{
+			const auto fg = color::rgb(std::uint8_t(y), std::uint8_t(255 - y), 40);
+			const auto bg = color::rgb(10, std::uint8_t(y), std::uint8_t(200 - y/2));
+			screen.clear({ { 0, y }, { size.width, 1 } }, bg);
+
+			std::string text;
+			while(text.size() < size.width - 60)
+				text += fmt::format("row {:3d} ", y);
+			screen.print({ y % 40, y }, text, Look(fg, bg));
+		}
+		screen.update();
+	};
+
+	TestScreen single(size);
+	single.screen.set_max_bands(1);
+	draw(single.screen);
+	TestTerminal single_term(size);
+	single_term.feed(single.output());
+
+	TestScreen banded(size);
+	banded.screen.set_max_bands(4);
+	REQUIRE(banded.screen.max_bands() == 4);
+	draw(banded.screen);
+	const auto out = banded.output();
+	TestTerminal banded_term(size);
+	banded_term.feed(out);
+
+	// each band starts at an absolute position, with the default look
+	REQUIRE(out.find("\x1b[51H\x1b[m") != std::string::npos);
+	REQUIRE(out.find("\x1b[101H\x1b[m") != std::string::npos);
+	REQUIRE(out.find("\x1b[151H\x1b[m") != std::string::npos);
+
+	REQUIRE(banded_term.unsupported.empty());
+	REQUIRE(single_term.unsupported.empty());
+
+	// the terminal shows the screen's content, the same as when rendered in one piece
+	const auto color_str = [](Color c) {
+		return c == color::Default? std::string(): fmt::format("{};{};{}", color::red(c), color::green(c), color::blue(c));
+	};
+	const auto check = [&color_str](Screen &screen, const TestTerminal &term) {
+		for(auto y = 0ul; y < size.height; ++y)
+		{
+			for(auto x = 0ul; x < size.width; ++x)
+			{
+				const auto cell = screen.pick({ x, y });
+				const auto ch = cell.ch[0] == '\0'? ' ': cell.ch[0];
+				const TestTerminal::Cell expected { ch, ch == ' '? "": color_str(cell.look.fg), color_str(cell.look.bg) };
+				if(term.cell(x, y) != expected)
+				{
+					INFO("at " << x << "," << y);
+					REQUIRE(term.cell(x, y).ch == expected.ch);
+					REQUIRE(term.cell(x, y).fg == expected.fg);
+					REQUIRE(term.cell(x, y).bg == expected.bg);
+				}
+			}
+		}
+	};
+	check(banded.screen, banded_term);
+	REQUIRE(banded_term == single_term);
+
+	// nothing left to write
+	banded.screen.update();
+	REQUIRE(banded.output().empty());
+
+	SECTION("a band with only a shift")
+	{
+		// a small change (not banded), then rows 0-99 rewritten (2 bands),
+		//   while the second band's only change is text deleted from row 150
+		static constexpr auto row { 150ul };
+		const auto edit = [](Screen &screen, bool deleted) {
+			if(not deleted)
+			{
+				screen.clear({ { 0, row }, { size.width, 1 } }, color::Default, color::Default);
+				screen.print({ 10, row }, "the quick brown fox jumps over the lazy dog", Look());
+			}
+			else
+			{
+				for(auto y = 0ul; y < 100; ++y)
+					screen.print({ 0, y }, std::string(size.width, char('a' + y % 26)), Look(color::rgb(200, 200, 200), color::Default));
+				screen.print({ 10, row }, "the brown fox jumps over the lazy dog", Look());
+				screen.clear({ { 47, row }, { 6, 1 } }, color::Default, color::Default);
+			}
+			screen.update();
+		};
+
+		for(const auto deleted: { false, true })
+		{
+			edit(single.screen, deleted);
+			single_term.feed(single.output());
+			edit(banded.screen, deleted);
+			const auto edit_out = banded.output();
+			banded_term.feed(edit_out);
+
+			if(deleted)
+			{
+				REQUIRE(edit_out.find("\x1b[101H\x1b[m\x1b[151;15H\x1b[6P\x1b[H") != std::string::npos);
+				REQUIRE(edit_out.ends_with("\x1b[H"));  // (the cursor is back at the origin)
+			}
+		}
+
+		REQUIRE(banded_term.unsupported.empty());
+		REQUIRE(single_term.unsupported.empty());
+		check(banded.screen, banded_term);
+		REQUIRE(banded_term == single_term);
+	}
+}
+
+TEST_CASE("Threaded rendering", "Screen::set_threaded") {
+	TestScreen ts({ 80, 10 });
+	auto &screen = ts.screen;
+	screen.update();
+	ts.output();
+
+	screen.set_threaded(true);
+	REQUIRE(screen.threaded());
+
+	for(auto frame = 0u; frame < 100; ++frame)
+	{
+		screen.print({ 2, 2 }, fmt::format("frame {:3d}", frame));
+		screen.update();
+
+		if(frame == 50)
+			screen.set_size({ 60, 8 });
+	}
+	screen.print({ 2, 4 }, "done");
+	screen.update();
+
+	// stopping the render thread writes everything that was published
+	screen.set_threaded(false);
+	REQUIRE(not screen.threaded());
+	auto out = ts.output();
+	REQUIRE(out.find("done") != std::string::npos);
+
+	// back to updating directly
+	screen.print({ 2, 4 }, "DONE");
+	screen.update();
+	out = ts.output();
+	REQUIRE(out.find("DONE") != std::string::npos);
+	REQUIRE(out.find("frame") == std::string::npos);
+}
+
+TEST_CASE("Screen is dirty until updated", "Screen::dirty") {
+	TestScreen ts({ 80, 10 });
+	auto &screen = ts.screen;
+	screen.update();
+	REQUIRE(not screen.dirty());
+
+	screen.print({ 2, 2 }, "hello");
+	REQUIRE(screen.dirty());
+	screen.update();
+	REQUIRE(not screen.dirty());
+
+	screen.invalidate({ { 0, 0 }, { 5, 5 } });
+	REQUIRE(screen.dirty());
+	screen.update();
+	REQUIRE(not screen.dirty());
+}
+
+TEST_CASE("Layers are composited over the base layer", "Screen::add_layer") {
+	TestScreen ts({ 80, 10 });
+	auto &screen = ts.screen;
+	screen.print({ 0, 0 }, "base layer");
+	screen.print({ 0, 5 }, "underneath", { color::White, style::Default, color::Blue });
+	screen.update();
+	ts.output();
+
+	const auto popup = screen.add_layer();
+	screen.select_layer(popup);
+	REQUIRE(screen.selected_layer() == popup);
+	screen.clear({ { 5, 4 }, { 20, 3 } }, color::Red);
+	screen.print({ 6, 5 }, "popup");
+	screen.update();
+
+	// only the popup is written
+	auto out = ts.output();
+	REQUIRE(out.find("popup") != std::string::npos);
+	REQUIRE(out.find("base") == std::string::npos);
+	REQUIRE(std::string_view(screen.pick({ 6, 5 }).ch) == "p");
+	REQUIRE(screen.pick({ 6, 5 }).look.bg == color::Red);
+	REQUIRE(std::string_view(screen.pick({ 0, 0 }).ch) == "b");
+	REQUIRE(std::string_view(screen.pick({ 0, 5 }).ch) == "u");
+
+	// text on a transparent background
+	screen.print({ 0, 8 }, "overlay", { color::Yellow, style::Default, color::Transparent });
+	screen.update();
+	REQUIRE(std::string_view(screen.pick({ 0, 8 }).ch) == "o");
+	REQUIRE(screen.pick({ 0, 8 }).look.bg == color::Default);
+
+	// drawing on the base layer, beneath the popup
+	screen.select_layer(0);
+	screen.print({ 0, 5 }, "UNDERNEATH", { color::White, style::Default, color::Blue });
+	screen.update();
+	out = ts.output();
+	REQUIRE(out.find("UNDE") != std::string::npos);
+	REQUIRE(out.find("NEATH") == std::string::npos);
+	REQUIRE(std::string_view(screen.pick({ 6, 5 }).ch) == "p");
+
+	// hiding it reveals what's below
+	screen.hide_layer(popup);
+	REQUIRE(screen.dirty());
+	screen.update();
+	out = ts.output();
+	REQUIRE(out.find("NEATH") != std::string::npos);
+	REQUIRE(std::string_view(screen.pick({ 6, 5 }).ch) == "E");
+	REQUIRE(screen.pick({ 6, 5 }).look.bg == color::Blue);
+
+	screen.show_layer(popup);
+	screen.update();
+	REQUIRE(ts.output().find("popup") != std::string::npos);
+
+	screen.remove_layer(popup);
+	REQUIRE(screen.selected_layer() == 0);
+	screen.update();
+	REQUIRE(ts.output().find("NEATH") != std::string::npos);
+	REQUIRE(std::string_view(screen.pick({ 0, 8 }).ch) != "o");
+}
+
+TEST_CASE("Regions draw within their bounds", "Region") {
+	TestScreen ts({ 80, 10 });
+	auto &screen = ts.screen;
+	screen.update();
+	ts.output();
+
+	auto left = screen.region({ { 0, 2 }, { 10, 4 } });
+	auto right = screen.region({ { 40, 2 }, { 40, 4 } });
+	REQUIRE(left.size() == Size{ 10, 4 });
+	REQUIRE(not left.dirty());
+
+	// clipped to the right edge of the region
+	REQUIRE(left.print({ 2, 1 }, "truncated text") == 8);
+	REQUIRE(std::string_view(screen.pick({ 2, 3 }).ch) == "t");
+	REQUIRE(std::string_view(screen.pick({ 9, 3 }).ch) == "e");
+	REQUIRE(screen.pick({ 10, 3 }).ch[0] == '\0');
+	REQUIRE(left.cursor().x == 10);
+
+	REQUIRE(left.dirty());
+	REQUIRE(not right.dirty());
+	REQUIRE(screen.cursor().x == 0);  // the screen's cursor is not affected
+
+	screen.update();
+	REQUIRE(not left.dirty());
+	REQUIRE(ts.output().find("truncat") != std::string::npos);
+
+	// drawing on the other one only
+	Canvas canvas(right);
+	canvas.fill(color::Red);
+	REQUIRE(right.dirty());
+	REQUIRE(not left.dirty());
+	REQUIRE(screen.pick({ 40, 2 }).look.bg == color::Red);
+	REQUIRE(screen.pick({ 79, 5 }).look.bg == color::Red);
+	REQUIRE(screen.pick({ 39, 2 }).look.bg != color::Red);
+	REQUIRE(screen.pick({ 40, 6 }).look.bg != color::Red);
+
+	// nested, clipped to its parent
+	auto inner = right.region({ { 35, 1 }, { 10, 10 } });
+	REQUIRE(inner.bounds().top_left.x == 75);
+	REQUIRE(inner.bounds().top_left.y == 3);
+	REQUIRE(inner.size() == Size{ 5, 3 });
+	inner.clear(color::Blue);
+	REQUIRE(screen.pick({ 75, 3 }).look.bg == color::Blue);
+	REQUIRE(screen.pick({ 74, 3 }).look.bg == color::Red);
+
+	screen.update();
+	REQUIRE(not right.dirty());
+}
+
+TEST_CASE("Blitting an offscreen surface", "Surface") {
+	TestScreen ts({ 80, 10 });
+	auto &screen = ts.screen;
+	screen.update();
+	ts.output();
+
+	Surface widget({ 20, 3 });
+	Canvas(widget).fill(color::Blue);
+	widget.print({ 1, 1 }, "offscreen widget");
+	REQUIRE(widget.cursor().x == 17);
+
+	screen.blit(widget, { 70, 8 });  // clipped to the screen
+	REQUIRE(screen.dirty());
+	REQUIRE(std::string_view(screen.pick({ 71, 9 }).ch) == "o");
+	REQUIRE(screen.pick({ 79, 8 }).look.bg == color::Blue);
+	screen.update();
+	REQUIRE(ts.output().find("offscree") != std::string::npos);
+
+	// the same content again; nothing to write
+	screen.blit(widget, { 70, 8 });
+	screen.update();
+	REQUIRE(ts.output().find("offscree") == std::string::npos);
+
+	// a part of it, into a region
+	auto pane = screen.region({ { 10, 2 }, { 5, 5 } });
+	pane.blit(widget, { { 1, 1 }, { 20, 1 } }, { 0, 0 });
+	REQUIRE(pane.dirty());
+	REQUIRE(std::string_view(screen.pick({ 10, 2 }).ch) == "o");
+	REQUIRE(std::string_view(screen.pick({ 14, 2 }).ch) == "c");
+	REQUIRE(screen.pick({ 15, 2 }).look.bg != color::Blue);
+	REQUIRE(screen.pick({ 10, 3 }).look.bg != color::Blue);
+}
+
+TEST_CASE("Resizing only writes what the terminal doesn't show", "Screen::set_size") {
+	TestScreen ts({ 80, 10 });
+	auto &screen = ts.screen;
+
+	const auto draw = [&screen] {
+		screen.clear();
+		for(auto y = 0u; y < screen.size().height; ++y)
+			screen.print({ 0, y }, fmt::format("line {} ", y));
+	};
+	draw();
+	screen.update();
+	ts.output();
+
+	screen.set_size({ 60, 12 });
+	draw();
+	screen.update();
+	auto out = ts.output();
+	REQUIRE(out.find("line 3") == std::string::npos);
+	REQUIRE(out.find("line 11") != std::string::npos);
+
+	screen.set_size({ 40, 5 });
+	draw();
+	screen.update();
+	out = ts.output();
+	REQUIRE(out.find("line") == std::string::npos);
+}
+
+TEST_CASE("Resizing to the same size keeps the layers", "Screen::set_size") {
+	TestScreen ts({ 40, 10 });
+	auto &screen = ts.screen;
+
+	screen.print({ 0, 0 }, "base");
+	const auto popup = screen.add_layer();
+	screen.select_layer(popup);
+	screen.print({ 2, 2 }, "popup");
+	screen.update();
+	ts.output();
+
+	screen.set_size({ 40, 10 });
+	REQUIRE(not screen.dirty());
+	REQUIRE(screen.pick({ 2, 2 }).ch[0] == 'p');
+	screen.update();
+	REQUIRE(ts.output().empty());
+}
+
+TEST_CASE("Repainting rewrites everything", "Screen::repaint") {
+	TestScreen ts({ 80, 10 });
+	auto &screen = ts.screen;
+
+	screen.print({ 2, 3 }, "still here");
+	screen.update();
+	ts.output();
+
+	screen.repaint();
+	screen.update();
+	const auto out = ts.output();
+	REQUIRE(out.find("\x1b[2J") != std::string::npos);
+	REQUIRE(out.find("still here") != std::string::npos);
+
+	screen.update();
+	REQUIRE(ts.output().empty());
+}
+
+TEST_CASE("Updates don't allocate", "Screen::update") {
+	Size size { 120, 30 };
+	std::size_t bands { 1 };
+	SECTION("rendered in one piece") {}
+	SECTION("rendered in concurrent bands")
+	{
+		size = { 640, 200 };
+		bands = 4;
+	}
+
+	TestScreen ts(size);
+	auto &screen = ts.screen;
+	screen.set_max_bands(bands);
+
+	const auto draw = [&screen, size](std::uint8_t frame) {
+		for(auto y = 0u; y < size.height; ++y)
+		{
+			for(auto x = 0u; x < size.width; x += 3)
+			{
+				const Look lk {
+					color::rgb(std::uint8_t(x), frame, std::uint8_t(y)),
+					(x + y + frame) % 5 == 0? color::Default: color::rgb(frame, std::uint8_t(y), 200),
+					(x + frame) % 4 == 0? Style(style::Bold | style::Underline): style::Italic,
+				};
+				screen.print({ x + frame % 2, y }, "ab", lk);
+			}
+		}
+	};
+	// the output buffers grow to what a frame needs
+	draw(0);
+	screen.update();
+	ts.output();
+
+	for(auto frame = 1u; frame < 4; ++frame)
+	{
+		draw(std::uint8_t(frame));
+		const auto before = g_allocations.load();
+		screen.update();
+		const auto allocations = g_allocations.load() - before;
+		REQUIRE(allocations == 0);
+
+		const auto out = ts.output();
+		REQUIRE(out.find("\x1b[38;2;") != std::string::npos);
+		if(bands > 1)
+			REQUIRE(out.find("\x1b[151H\x1b[m") != std::string::npos);
+	}
+}
+
+TEST_CASE("Budgeted update resumes where it stopped", "Screen::update") {
+	TestScreen ts({ 80, 10 });
+	auto &screen = ts.screen;
+	screen.update();
+	ts.output();
+
+	for(auto y = 0u; y < 10; ++y)
+		screen.print({ 0, y }, fmt::format("row {} {:->70}", y, y));
+
+	// only (about) one row fits in the budget
+	const Screen::Budget budget { .bytes = 100 };
+	screen.update(budget);
+	REQUIRE(screen.dirty());
+	auto out = ts.output();
+	REQUIRE(out.find("row 0") != std::string::npos);
+	REQUIRE(out.find("row 9") == std::string::npos);
+
+	auto updates { 1u };
+	while(screen.dirty() and updates < 20)
+	{
+		screen.update(budget);
+		out += ts.output();
+		++updates;
+	}
+	REQUIRE(not screen.dirty());
+	REQUIRE(updates > 2);
+
+	for(auto y = 0u; y < 10; ++y)
+		REQUIRE(out.find(fmt::format("row {} ", y)) != std::string::npos);
+
+	// everything was written
+	screen.update();
+	REQUIRE(ts.output().empty());
+}
+
+TEST_CASE("Updates are dropped while the terminal is congested", "Screen::frames_dropped") {
+	TestPty pty;
+	REQUIRE(pty.slave >= 0);
+
+	Screen screen(pty.slave);
+	screen.set_size({ 80, 10 });
+	screen.update();
+	pty.read();
+	REQUIRE(screen.frames_dropped() == 0);
+
+	pty.fill();
+
+	screen.print({ 2, 2 }, "hello");
+	screen.update();
+	REQUIRE(screen.frames_dropped() == 1);
+	REQUIRE(screen.dirty());
+
+	// the terminal caught up
+	pty.read();
+	screen.update();
+	REQUIRE(screen.frames_dropped() == 1);
+	REQUIRE(not screen.dirty());
+
+	// the render thread waits for it without polling (i.e. without waking up constantly)
+	screen.set_threaded(true);
+	pty.fill();
+
+	screen.print({ 2, 4 }, "world");
+	screen.update();
+
+	::rusage before {};
+	::getrusage(RUSAGE_SELF, &before);
+	std::this_thread::sleep_for(200ms);
+	::rusage after {};
+	::getrusage(RUSAGE_SELF, &after);
+	REQUIRE(after.ru_nvcsw - before.ru_nvcsw < 20);
+
+	// it continues by itself once the terminal caught up
+	std::string received;
+	for(auto attempts = 0u; received.find("world") == std::string::npos and attempts < 1000; ++attempts)
+	{
+		received += pty.read();
+		std::this_thread::sleep_for(1ms);
+	}
+	REQUIRE(received.find("world") != std::string::npos);
+	screen.set_threaded(false);
+}
+
+TEST_CASE("Output the terminal doesn't accept is written later", "Screen::pending_output") {
+	TestPty pty;
+	REQUIRE(pty.slave >= 0);
+	std::string received;
+
+	Screen screen(pty.slave);
+	screen.set_size({ 200, 50 });
+
+	// much more than the pty's buffer holds; writing it must not block
+	for(auto y = 0u; y < 50; ++y)
+	{
+		for(auto x = 0u; x < 200; x += 10)
+			screen.print({ x, y }, fmt::format("{:3}:{:<6}", y, x), Look(color::rgb(std::uint8_t(x), std::uint8_t(y), 9), color::rgb(9, std::uint8_t(y), std::uint8_t(x))));
+	}
+	screen.update();
+	REQUIRE(screen.pending_output() > 0);
+	REQUIRE(not screen.write_pending());
+
+	// more changes are held back until the terminal caught up
+	const auto dropped = screen.frames_dropped();
+	screen.print({ 0, 0 }, "the end");
+	screen.update();
+	REQUIRE(screen.frames_dropped() == dropped + 1);
+
+	for(auto attempts = 0u; screen.pending_output() > 0 and attempts < 1000; ++attempts)
+	{
+		received += pty.read();
+		screen.write_pending();
+	}
+	REQUIRE(screen.pending_output() == 0);
+
+	screen.update();
+	REQUIRE(not screen.dirty());
+	received += pty.read();
+
+	// everything arrived, in order
+	const auto last_row = received.find(" 49:190");
+	const auto the_end = received.find("the end");
+	REQUIRE(last_row != std::string::npos);
+	REQUIRE(the_end != std::string::npos);
+	REQUIRE(the_end > last_row);
+}
+
+TEST_CASE("Writing with io_uring", "Screen::set_io_uring") {
+	TestScreen plain({ 60, 8 });
+	TestScreen async({ 60, 8 });
+	if(not async.screen.set_io_uring(true))
+	{
+		WARN("io_uring isn't available");
+		return;
+	}
+	REQUIRE(async.screen.io_uring());
+
+	for(auto frame = 0u; frame < 5; ++frame)
+	{
+		for(auto *ts: { &plain, &async })
+		{
+			ts->screen.print({ frame, frame }, fmt::format("frame {}", frame), Look(color::rgb(std::uint8_t(frame*50), 0, 0)));
+			ts->screen.update();
+		}
+
+		REQUIRE(async.screen.drain_output(1s));
+		REQUIRE(async.screen.pending_output() == 0);
+		REQUIRE(async.output() == plain.output());
+	}
+
+	REQUIRE(not async.screen.set_io_uring(false));
+
+	// a terminal that doesn't keep up doesn't block the update
+	TestPty pty;
+	REQUIRE(pty.slave >= 0);
+
+	{
+		Screen screen(pty.slave);
+		screen.set_size({ 500, 250 });  // more than the terminal buffers
+		REQUIRE(screen.set_io_uring(true));
+
+		for(auto y = 0u; y < 250; ++y)
+			screen.print({ 0, y }, std::string(500, char('a' + y % 26)), Look(color::rgb(std::uint8_t(y), 0, 0)));
+		screen.update();
+		REQUIRE(screen.pending_output() > 0);
+
+		// meanwhile, the next update is queued behind the write in flight; more are dropped until it's submitted
+		screen.print({ 0, 0 }, "queued");
+		screen.update();
+		REQUIRE(screen.frames_dropped() == 0);
+		REQUIRE(not screen.dirty());
+
+		screen.print({ 0, 1 }, "dropped");
+		screen.update();
+		REQUIRE(screen.frames_dropped() == 1);
+		REQUIRE(screen.dirty());
+
+		std::string received;
+		for(auto attempts = 0u; screen.pending_output() > 0 and attempts < 10000; ++attempts)
+		{
+			received += pty.read();
+			screen.write_pending();
+		}
+		REQUIRE(screen.pending_output() == 0);
+
+		// the dropped one goes with the next update
+		screen.update();
+		REQUIRE(not screen.dirty());
+		REQUIRE(screen.drain_output(1s));
+		received += pty.read();
+
+		const std::string row(500, 'p');
+		const auto first = received.find(row);
+		const auto queued = received.find("queued");
+		const auto dropped = received.find("dropped");
+		REQUIRE(first != std::string::npos);
+		REQUIRE(queued != std::string::npos);
+		REQUIRE(dropped != std::string::npos);
+		REQUIRE(first < queued);
+		REQUIRE(queued < dropped);
+	}
+
+	// a write the terminal never takes is cancelled when the screen goes away
+	{
+		const auto start = std::chrono::steady_clock::now();
+		{
+			Screen screen(pty.slave);
+			screen.set_size({ 500, 250 });  // more than the terminal buffers
+			REQUIRE(screen.set_io_uring(true));
+
+			for(auto y = 0u; y < 250; ++y)
+				screen.print({ 0, y }, std::string(500, char('A' + y % 26)), Look(color::rgb(std::uint8_t(y), 0, 0)));
+			screen.update();
+			REQUIRE(screen.pending_output() > 0);
+		}
+		REQUIRE(std::chrono::steady_clock::now() - start < 5s);
+	}
+}